@@ -0,0 +1,290 @@
+#include "alloc_tracker.h"
+#include "profile_zone.h"
+#include <SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+    const int MAX_ZONES = 128;
+    const int MAX_BUFFERS = 16;
+
+    struct ZoneSlot {
+        std::atomic<const char*> name;
+        std::atomic<uint64_t> frameAllocations;
+        std::atomic<uint64_t> frameBytes;
+        std::atomic<uint64_t> totalAllocations;
+        std::atomic<uint64_t> totalBytes;
+    };
+
+    struct BufferSlot {
+        const char* name;
+        size_t bytes;
+        size_t peakBytes;
+    };
+
+    ZoneSlot zones[MAX_ZONES];
+    BufferSlot buffers[MAX_BUFFERS];
+
+    std::atomic<uint64_t> frameAllocations{ 0 };
+    std::atomic<uint64_t> frameBytes{ 0 };
+    std::atomic<uint64_t> frameFrees{ 0 };
+    std::atomic<size_t> liveHeapBytes{ 0 };
+    std::atomic<size_t> peakHeapBytes{ 0 };
+
+    AllocTracker::FrameStats peakFrameStats = { 0, 0, 0 };
+    uint64_t budgetAllocations = 0;
+    uint64_t budgetBytes = 0;
+    int warmupFrames = 0;
+    int framesSeen = 0;
+
+#ifdef ENGINE_ALLOC_TRACKING
+    ZoneSlot& zoneFor(const char* name) {
+        size_t start = (reinterpret_cast<uintptr_t>(name) >> 3) % MAX_ZONES;
+        for (int probe = 0; probe < MAX_ZONES; probe++) {
+            ZoneSlot& slot = zones[(start + probe) % MAX_ZONES];
+            const char* current = slot.name.load(std::memory_order_acquire);
+            if (current == name) return slot;
+            if (!current) {
+                const char* expected = nullptr;
+                if (slot.name.compare_exchange_strong(expected, name) || expected == name) return slot;
+            }
+        }
+        return zones[start];
+    }
+
+    void recordAllocation(size_t size) {
+        frameAllocations.fetch_add(1, std::memory_order_relaxed);
+        frameBytes.fetch_add(size, std::memory_order_relaxed);
+
+        size_t live = liveHeapBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = peakHeapBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakHeapBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+        ZoneSlot& zone = zoneFor(ProfileZone::current());
+        zone.frameAllocations.fetch_add(1, std::memory_order_relaxed);
+        zone.frameBytes.fetch_add(size, std::memory_order_relaxed);
+        zone.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+        zone.totalBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void recordFree(size_t size) {
+        frameFrees.fetch_add(1, std::memory_order_relaxed);
+        liveHeapBytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    // Every tracked block carries a header just below the user pointer with the
+    // malloc'd base and the requested size, so frees know what they release.
+    struct BlockHeader {
+        void* base;
+        size_t size;
+    };
+    static_assert(sizeof(BlockHeader) <= 16, "header must fit the default alignment");
+    const size_t HEADER_SPACE = 16;
+
+    void* trackedAlloc(size_t size, size_t alignment) {
+        if (alignment < HEADER_SPACE) alignment = HEADER_SPACE;
+        // malloc already returns 16-byte aligned blocks, so alignment bytes of slack
+        // always leave room for the header in front of the aligned pointer.
+        void* base = std::malloc(size + alignment);
+        if (!base) return nullptr;
+        uintptr_t user = (reinterpret_cast<uintptr_t>(base) + HEADER_SPACE + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(user) - 1;
+        header->base = base;
+        header->size = size;
+        recordAllocation(size);
+        return reinterpret_cast<void*>(user);
+    }
+
+    void trackedFree(void* ptr) {
+        if (!ptr) return;
+        BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+        recordFree(header->size);
+        std::free(header->base);
+    }
+
+    void* sdlMalloc(size_t size) {
+        return trackedAlloc(size, HEADER_SPACE);
+    }
+
+    void* sdlCalloc(size_t count, size_t size) {
+        void* ptr = trackedAlloc(count * size, HEADER_SPACE);
+        if (ptr) std::memset(ptr, 0, count * size);
+        return ptr;
+    }
+
+    void* sdlRealloc(void* ptr, size_t size) {
+        if (!ptr) return sdlMalloc(size);
+        BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+        size_t oldSize = header->size;
+        void* grown = sdlMalloc(size);
+        if (!grown) return nullptr;
+        std::memcpy(grown, ptr, std::min(oldSize, size));
+        trackedFree(ptr);
+        return grown;
+    }
+
+    void sdlFree(void* ptr) {
+        trackedFree(ptr);
+    }
+#endif
+}
+
+#ifdef ENGINE_ALLOC_TRACKING
+void* operator new(size_t size) {
+    void* ptr = trackedAlloc(size, HEADER_SPACE);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    void* ptr = trackedAlloc(size, HEADER_SPACE);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size, HEADER_SPACE); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size, HEADER_SPACE); }
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    void* ptr = trackedAlloc(size, static_cast<size_t>(alignment));
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    void* ptr = trackedAlloc(size, static_cast<size_t>(alignment));
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+#endif
+
+bool AllocTracker::enabled() {
+#ifdef ENGINE_ALLOC_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocTracker::installSDLHooks() {
+#ifdef ENGINE_ALLOC_TRACKING
+    SDL_SetMemoryFunctions(sdlMalloc, sdlCalloc, sdlRealloc, sdlFree);
+#endif
+}
+
+void AllocTracker::beginFrame() {
+    frameAllocations.store(0, std::memory_order_relaxed);
+    frameBytes.store(0, std::memory_order_relaxed);
+    frameFrees.store(0, std::memory_order_relaxed);
+    for (auto& zone : zones) {
+        zone.frameAllocations.store(0, std::memory_order_relaxed);
+        zone.frameBytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+AllocTracker::FrameStats AllocTracker::endFrame() {
+    FrameStats stats = {
+        frameAllocations.load(std::memory_order_relaxed),
+        frameBytes.load(std::memory_order_relaxed),
+        frameFrees.load(std::memory_order_relaxed)
+    };
+
+    framesSeen++;
+    if (framesSeen > warmupFrames) {
+        peakFrameStats.allocations = std::max(peakFrameStats.allocations, stats.allocations);
+        peakFrameStats.bytes = std::max(peakFrameStats.bytes, stats.bytes);
+        peakFrameStats.frees = std::max(peakFrameStats.frees, stats.frees);
+    }
+    return stats;
+}
+
+AllocTracker::FrameStats AllocTracker::peakFrame() {
+    return peakFrameStats;
+}
+
+size_t AllocTracker::liveBytes() {
+    return liveHeapBytes.load(std::memory_order_relaxed);
+}
+
+size_t AllocTracker::peakLiveBytes() {
+    return peakHeapBytes.load(std::memory_order_relaxed);
+}
+
+void AllocTracker::trackBuffer(const char* name, size_t bytes) {
+    if (!enabled()) return;
+    for (auto& buffer : buffers) {
+        if (buffer.name == name || !buffer.name) {
+            buffer.name = name;
+            buffer.bytes = bytes;
+            buffer.peakBytes = std::max(buffer.peakBytes, bytes);
+            return;
+        }
+    }
+}
+
+void AllocTracker::setFrameBudget(uint64_t maxAllocations, uint64_t maxBytes, int warmup) {
+    budgetAllocations = maxAllocations;
+    budgetBytes = maxBytes;
+    warmupFrames = warmup;
+}
+
+bool AllocTracker::overBudget(const FrameStats& stats) {
+    if (framesSeen <= warmupFrames) return false;
+    if (budgetAllocations > 0 && stats.allocations > budgetAllocations) return true;
+    if (budgetBytes > 0 && stats.bytes > budgetBytes) return true;
+    return false;
+}
+
+void AllocTracker::report(std::ostream& out) {
+    if (!enabled()) {
+        out << "Allocation tracking is not compiled in (define ENGINE_ALLOC_TRACKING).\n";
+        return;
+    }
+
+    out << "Allocation report after " << framesSeen << " frames\n";
+    out << "  peak frame: " << peakFrameStats.allocations << " allocations, " << peakFrameStats.bytes << " bytes\n";
+    out << "  live heap: " << liveBytes() << " bytes (high-water " << peakLiveBytes() << ")\n";
+
+    int order[MAX_ZONES];
+    int used = 0;
+    for (int i = 0; i < MAX_ZONES; i++) {
+        if (zones[i].name.load()) order[used++] = i;
+    }
+    std::sort(order, order + used, [](int a, int b) {
+        return zones[a].totalBytes.load() > zones[b].totalBytes.load();
+        });
+    out << "  by zone (total allocations / bytes):\n";
+    for (int i = 0; i < used; i++) {
+        const ZoneSlot& zone = zones[order[i]];
+        out << "    " << zone.name.load() << ": " << zone.totalAllocations.load() << " / " << zone.totalBytes.load() << "\n";
+    }
+
+    out << "  buffers (current / peak bytes):\n";
+    for (const auto& buffer : buffers) {
+        if (!buffer.name) break;
+        out << "    " << buffer.name << ": " << buffer.bytes << " / " << buffer.peakBytes << "\n";
+    }
+}
+
+void AllocTracker::reportFrame(std::ostream& out) {
+    out << "Frame " << framesSeen << ": " << frameAllocations.load() << " allocations, " << frameBytes.load() << " bytes\n";
+    for (const auto& zone : zones) {
+        uint64_t count = zone.frameAllocations.load();
+        if (count == 0) continue;
+        out << "    " << zone.name.load() << ": " << count << " / " << zone.frameBytes.load() << " bytes\n";
+    }
+}
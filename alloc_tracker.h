@@ -0,0 +1,49 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Allocation instrumentation. Build with ENGINE_ALLOC_TRACKING defined to hook
+// global operator new/delete and SDL's allocator; without it every call here
+// is a cheap no-op and enabled() returns false.
+//
+// Allocations are attributed to the active ProfileZone of the allocating
+// thread. Counts are kept per frame and in total, along with the high-water
+// mark of live heap bytes.
+class AllocTracker {
+public:
+    struct FrameStats {
+        uint64_t allocations;
+        uint64_t bytes;
+        uint64_t frees;
+    };
+
+    static bool enabled();
+
+    // Routes SDL_malloc & co. through the tracker. Must run before SDL_Init.
+    static void installSDLHooks();
+
+    static void beginFrame();
+    static FrameStats endFrame();
+
+    // Largest frame so far, after the warm-up frames.
+    static FrameStats peakFrame();
+    static size_t liveBytes();
+    static size_t peakLiveBytes();
+
+    // Records the capacity of a long-lived container so unbounded growth shows
+    // up in the report even when it happens in large, infrequent steps.
+    static void trackBuffer(const char* name, size_t bytes);
+
+    // A budget of zero disables that limit. Frames before warmupFrames are not
+    // checked, since they load fonts and fill caches.
+    static void setFrameBudget(uint64_t maxAllocations, uint64_t maxBytes, int warmupFrames);
+    static bool overBudget(const FrameStats& stats);
+
+    static void report(std::ostream& out);
+    static void reportFrame(std::ostream& out);
+};
+
+#endif // ALLOC_TRACKER_H
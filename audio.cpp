@@ -0,0 +1,188 @@
+#include "audio.h"
+#include "log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    const float PI = 3.14159265f;
+
+    // Appends a tone that glides from startHz to endHz with an exponential decay.
+    void appendTone(std::vector<float>& out, int rate, float startHz, float endHz, float seconds, float amplitude) {
+        int count = static_cast<int>(seconds * rate);
+        float phase = 0.0f;
+        for (int i = 0; i < count; i++) {
+            float t = static_cast<float>(i) / count;
+            float frequency = startHz + (endHz - startHz) * t;
+            phase += 2.0f * PI * frequency / rate;
+            float envelope = std::exp(-4.0f * t) * std::min(1.0f, i / (0.005f * rate));
+            out.push_back(amplitude * envelope * std::sin(phase));
+        }
+    }
+}
+
+AudioMixer::AudioMixer()
+    : device(0),
+    deviceSpec(),
+    voices(),
+    commands(),
+    commandHead(0),
+    commandTail(0),
+    callbackCount(0),
+    playedCount(0),
+    droppedCount(0),
+    stolenCount(0) {
+}
+
+AudioMixer::~AudioMixer() {
+    close();
+}
+
+bool AudioMixer::open(bool lowLatency) {
+    if (device) return true;
+
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+        LOG_ERROR("Audio could not initialize: {}", SDL_GetError());
+        return false;
+    }
+
+    SDL_AudioSpec want;
+    SDL_zero(want);
+    want.freq = 48000;
+    want.format = AUDIO_S16SYS;
+    want.channels = 2;
+    want.samples = lowLatency ? 256 : 2048;
+    want.callback = audioCallback;
+    want.userdata = this;
+
+    // Keep the spec we asked for so the callback format is fixed; SDL converts
+    // to whatever the hardware wants.
+    device = SDL_OpenAudioDevice(nullptr, 0, &want, &deviceSpec, 0);
+    if (!device) {
+        LOG_ERROR("Audio device could not be opened: {}", SDL_GetError());
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    synthesizeSounds(deviceSpec.freq);
+    mixBuffer.assign(static_cast<size_t>(deviceSpec.samples) * deviceSpec.channels, 0.0f);
+    for (auto& voice : voices) voice = { nullptr, 0, 0, 0.0f };
+
+    SDL_PauseAudioDevice(device, 0);
+    LOG_INFO("Audio opened on '{}' driver: {} Hz, {} frame buffer", SDL_GetCurrentAudioDriver(), deviceSpec.freq, deviceSpec.samples);
+    return true;
+}
+
+void AudioMixer::close() {
+    if (!device) return;
+    SDL_CloseAudioDevice(device);
+    device = 0;
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    commandHead.store(0);
+    commandTail.store(0);
+}
+
+bool AudioMixer::play(SoundId sound, float volume) {
+    if (!device || sound < 0 || sound >= SOUND_COUNT) return false;
+    return pushCommand({ Command::PLAY, sound, volume });
+}
+
+void AudioMixer::stopAll() {
+    if (device) pushCommand({ Command::STOP_ALL, SOUND_EAT, 0.0f });
+}
+
+AudioMixer::Stats AudioMixer::stats() const {
+    return { callbackCount.load(), playedCount.load(), droppedCount.load(), stolenCount.load() };
+}
+
+bool AudioMixer::pushCommand(const Command& command) {
+    size_t head = commandHead.load(std::memory_order_relaxed);
+    if (head - commandTail.load(std::memory_order_acquire) >= QUEUE_SIZE) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    commands[head & (QUEUE_SIZE - 1)] = command;
+    commandHead.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void AudioMixer::audioCallback(void* userdata, Uint8* stream, int length) {
+    AudioMixer* mixer = static_cast<AudioMixer*>(userdata);
+    int frameBytes = static_cast<int>(sizeof(Sint16)) * mixer->deviceSpec.channels;
+    mixer->mix(reinterpret_cast<Sint16*>(stream), length / frameBytes);
+}
+
+void AudioMixer::mix(Sint16* output, int frames) {
+    callbackCount.fetch_add(1, std::memory_order_relaxed);
+
+    size_t tail = commandTail.load(std::memory_order_relaxed);
+    size_t head = commandHead.load(std::memory_order_acquire);
+    for (; tail != head; tail++) {
+        applyCommand(commands[tail & (QUEUE_SIZE - 1)]);
+    }
+    commandTail.store(tail, std::memory_order_release);
+
+    const int channels = deviceSpec.channels;
+    const int blockFrames = static_cast<int>(mixBuffer.size()) / channels;
+    while (frames > 0) {
+        int count = std::min(frames, blockFrames);
+        std::fill(mixBuffer.begin(), mixBuffer.begin() + static_cast<size_t>(count) * channels, 0.0f);
+
+        for (auto& voice : voices) {
+            if (!voice.samples) continue;
+            size_t remaining = voice.length - voice.position;
+            int voiceFrames = static_cast<int>(std::min<size_t>(remaining, count));
+            const float* source = voice.samples + voice.position;
+            for (int i = 0; i < voiceFrames; i++) {
+                float sample = source[i] * voice.gain;
+                for (int c = 0; c < channels; c++) mixBuffer[i * channels + c] += sample;
+            }
+            voice.position += voiceFrames;
+            if (voice.position >= voice.length) voice.samples = nullptr;
+        }
+
+        for (int i = 0; i < count * channels; i++) {
+            float sample = std::max(-1.0f, std::min(1.0f, mixBuffer[i]));
+            output[i] = static_cast<Sint16>(sample * 32767.0f);
+        }
+        output += count * channels;
+        frames -= count;
+    }
+}
+
+void AudioMixer::applyCommand(const Command& command) {
+    if (command.type == Command::STOP_ALL) {
+        for (auto& voice : voices) voice.samples = nullptr;
+        return;
+    }
+
+    const std::vector<float>& sound = sounds[command.sound];
+    Voice* target = nullptr;
+    for (auto& voice : voices) {
+        if (!voice.samples) {
+            target = &voice;
+            break;
+        }
+        // All voices busy: steal the one closest to finishing its sound.
+        if (!target || voice.length - voice.position < target->length - target->position) target = &voice;
+    }
+    if (target->samples) stolenCount.fetch_add(1, std::memory_order_relaxed);
+
+    *target = { sound.data(), sound.size(), 0, command.volume };
+    playedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioMixer::synthesizeSounds(int rate) {
+    for (auto& sound : sounds) sound.clear();
+
+    appendTone(sounds[SOUND_EAT], rate, 880.0f, 1320.0f, 0.08f, 0.5f);
+
+    appendTone(sounds[SOUND_GAME_OVER], rate, 440.0f, 110.0f, 0.6f, 0.6f);
+
+    appendTone(sounds[SOUND_BOOST], rate, 200.0f, 600.0f, 0.12f, 0.3f);
+
+    const float arpeggio[] = { 523.25f, 659.25f, 783.99f, 1046.5f };
+    for (float note : arpeggio) {
+        appendTone(sounds[SOUND_CELEBRATE], rate, note, note, 0.1f, 0.4f);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <SDL.h>
+#include <atomic>
+#include <vector>
+
+enum SoundId {
+    SOUND_EAT,
+    SOUND_GAME_OVER,
+    SOUND_BOOST,
+    SOUND_CELEBRATE,
+    SOUND_COUNT
+};
+
+// Software mixer running in SDL's audio callback. The game thread talks to it
+// only through a single-producer/single-consumer command queue, and all sample
+// data and voices are allocated up front, so the callback never locks or
+// allocates.
+class AudioMixer {
+public:
+    struct Stats {
+        Uint64 callbacks;
+        Uint64 commandsPlayed;
+        Uint64 commandsDropped;
+        Uint64 voicesStolen;
+    };
+
+    AudioMixer();
+    ~AudioMixer();
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    // lowLatency asks for a 256-frame device buffer instead of 2048.
+    bool open(bool lowLatency);
+    void close();
+    bool isOpen() const { return device != 0; }
+
+    // Game thread only. Returns false if the command queue is full.
+    bool play(SoundId sound, float volume = 1.0f);
+    void stopAll();
+
+    Stats stats() const;
+    int bufferFrames() const { return deviceSpec.samples; }
+    int sampleRate() const { return deviceSpec.freq; }
+
+private:
+    struct Command {
+        enum Type { PLAY, STOP_ALL } type;
+        SoundId sound;
+        float volume;
+    };
+
+    struct Voice {
+        const float* samples;
+        size_t length;
+        size_t position;
+        float gain;
+    };
+
+    static const int MAX_VOICES = 32;
+    static const size_t QUEUE_SIZE = 256;  // power of two
+
+    static void audioCallback(void* userdata, Uint8* stream, int length);
+    void mix(Sint16* output, int frames);
+    bool pushCommand(const Command& command);
+    void applyCommand(const Command& command);
+    void synthesizeSounds(int rate);
+
+    SDL_AudioDeviceID device;
+    SDL_AudioSpec deviceSpec;
+
+    std::vector<float> sounds[SOUND_COUNT];
+    Voice voices[MAX_VOICES];
+    std::vector<float> mixBuffer;
+
+    Command commands[QUEUE_SIZE];
+    std::atomic<size_t> commandHead;   // written by the game thread
+    std::atomic<size_t> commandTail;   // written by the audio callback
+
+    std::atomic<Uint64> callbackCount;
+    std::atomic<Uint64> playedCount;
+    std::atomic<Uint64> droppedCount;
+    std::atomic<Uint64> stolenCount;
+};
+
+#endif // AUDIO_H
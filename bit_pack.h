@@ -0,0 +1,409 @@
+#ifndef BIT_PACK_H
+#define BIT_PACK_H
+
+#include <SDL.h>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Appends bit-packed data to a byte vector, least significant bit first.
+// Call finish() before reading the vector.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<Uint8>& out) : out(out), size(out.size()), accumulator(0), used(0) {}
+
+    // count is 1..32 and value must fit in it.
+    void writeBits(Uint32 value, int count) {
+        accumulator |= static_cast<Uint64>(value) << used;
+        used += count;
+        if (used >= 32) {
+            spill();
+        }
+    }
+
+    void writeBool(bool value) { writeBits(value ? 1 : 0, 1); }
+
+    // Seven bits per group with a continuation bit; small values take 8 bits.
+    void writeVarint(Uint64 value) {
+        while (value >= 0x80) {
+            writeBits(static_cast<Uint32>(value & 0x7F) | 0x80, 8);
+            value >>= 7;
+        }
+        writeBits(static_cast<Uint32>(value), 8);
+    }
+
+    // Zigzag: small negative numbers stay small.
+    void writeSigned(Sint64 value) { writeVarint((static_cast<Uint64>(value) << 1) ^ static_cast<Uint64>(value >> 63)); }
+
+    // Flushes the partial byte, zero padded, and trims the vector.
+    void finish() {
+        while (used > 0) {
+            reserve(1);
+            out[size++] = static_cast<Uint8>(accumulator);
+            accumulator >>= 8;
+            used = used > 8 ? used - 8 : 0;
+        }
+        out.resize(size);
+    }
+
+private:
+    void reserve(size_t bytes) {
+        if (size + bytes > out.size()) {
+            // Grow into capacity a reused vector already has before doubling.
+            size_t grown = out.size() * 2 + 64;
+            out.resize(out.capacity() > grown ? out.capacity() : grown);
+        }
+    }
+
+    void spill() {
+        reserve(4);
+        Uint8* dst = out.data() + size;
+        dst[0] = static_cast<Uint8>(accumulator);
+        dst[1] = static_cast<Uint8>(accumulator >> 8);
+        dst[2] = static_cast<Uint8>(accumulator >> 16);
+        dst[3] = static_cast<Uint8>(accumulator >> 24);
+        size += 4;
+        accumulator >>= 32;
+        used -= 32;
+    }
+
+    std::vector<Uint8>& out;
+    size_t size;
+    Uint64 accumulator;
+    int used;
+};
+
+// Reads what BitWriter wrote. Reading past the end returns zero bits and
+// makes ok() false; check it once after decoding instead of after every read.
+class BitReader {
+public:
+    BitReader(const Uint8* data, size_t size) : data(data), end(data + size), accumulator(0), available(0), overrun(false) {}
+
+    Uint32 readBits(int count) {
+        if (available < count) {
+            refill(count);
+        }
+        Uint32 value = static_cast<Uint32>(accumulator & ((static_cast<Uint64>(1) << count) - 1));
+        accumulator >>= count;
+        available -= count;
+        return value;
+    }
+
+    bool readBool() { return readBits(1) != 0; }
+
+    Uint64 readVarint() {
+        Uint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            Uint32 group = readBits(8);
+            value |= static_cast<Uint64>(group & 0x7F) << shift;
+            if (!(group & 0x80)) return value;
+        }
+        overrun = true;
+        return value;
+    }
+
+    Sint64 readSigned() {
+        Uint64 value = readVarint();
+        return static_cast<Sint64>(value >> 1) ^ -static_cast<Sint64>(value & 1);
+    }
+
+    bool ok() const { return !overrun; }
+
+private:
+    // Tops the accumulator up to at least 56 bits. With 8 bytes left it is
+    // one unaligned load; bits above `available` may already hold the next
+    // byte, which the following refill ORs in again unchanged.
+    void refill(int count) {
+        if (end - data >= 8) {
+            Uint64 word;
+            std::memcpy(&word, data, sizeof(word));
+            accumulator |= SDL_SwapLE64(word) << available;
+            int bytes = (63 - available) >> 3;
+            data += bytes;
+            available += bytes * 8;
+            return;
+        }
+        while (available <= 56 && data < end) {
+            accumulator |= static_cast<Uint64>(*data++) << available;
+            available += 8;
+        }
+        if (available < count) {
+            overrun = true;
+            available = 64;
+        }
+    }
+
+    const Uint8* data;
+    const Uint8* end;
+    Uint64 accumulator;
+    int available;
+    bool overrun;
+};
+
+// Schemas: specialize Schema<T> with a FieldList of field codecs, one per
+// member, and packValue/unpackValue/packDelta/unpackDelta expand to straight
+// line code for that struct at compile time. Delta encoding writes one bit
+// per unchanged field; changed numeric fields store the difference from the
+// baseline.
+//
+//     template <> struct Schema<ScoreEntry> {
+//         typedef FieldList<PackString<&ScoreEntry::playerName, 32>,
+//                           PackVarint<&ScoreEntry::food>,
+//                           PackVarint<&ScoreEntry::time>> Fields;
+//     };
+template <typename T>
+struct Schema;
+
+template <typename Pointer>
+struct MemberOf;
+
+template <typename C, typename M>
+struct MemberOf<M C::*> {
+    typedef C Class;
+    typedef M Type;
+};
+
+// Non-negative integer, enum or bool in a fixed number of bits.
+template <auto Member, int Bits>
+struct PackBits {
+    typedef typename MemberOf<decltype(Member)>::Class Class;
+    typedef typename MemberOf<decltype(Member)>::Type Type;
+    static_assert(Bits >= 1 && Bits <= 32, "PackBits takes 1 to 32 bits");
+    static const Uint32 MASK = static_cast<Uint32>((static_cast<Uint64>(1) << Bits) - 1);
+
+    static void pack(BitWriter& writer, const Class& value) {
+        writer.writeBits(static_cast<Uint32>(value.*Member) & MASK, Bits);
+    }
+    static void unpack(BitReader& reader, Class& value) {
+        value.*Member = static_cast<Type>(reader.readBits(Bits));
+    }
+    static void packDelta(BitWriter& writer, const Class& value, const Class& base) {
+        bool changed = value.*Member != base.*Member;
+        writer.writeBool(changed);
+        if (changed) pack(writer, value);
+    }
+    static void unpackDelta(BitReader& reader, Class& value, const Class& base) {
+        if (reader.readBool()) unpack(reader, value);
+        else value.*Member = base.*Member;
+    }
+};
+
+// Integer of any size; signed values are zigzagged.
+template <auto Member>
+struct PackVarint {
+    typedef typename MemberOf<decltype(Member)>::Class Class;
+    typedef typename MemberOf<decltype(Member)>::Type Type;
+    static_assert(std::is_integral<Type>::value, "PackVarint takes an integer member");
+
+    static void pack(BitWriter& writer, const Class& value) {
+        if constexpr (std::is_signed<Type>::value) writer.writeSigned(static_cast<Sint64>(value.*Member));
+        else writer.writeVarint(static_cast<Uint64>(value.*Member));
+    }
+    static void unpack(BitReader& reader, Class& value) {
+        if constexpr (std::is_signed<Type>::value) value.*Member = static_cast<Type>(reader.readSigned());
+        else value.*Member = static_cast<Type>(reader.readVarint());
+    }
+    static void packDelta(BitWriter& writer, const Class& value, const Class& base) {
+        bool changed = value.*Member != base.*Member;
+        writer.writeBool(changed);
+        if (changed) writer.writeSigned(static_cast<Sint64>(static_cast<Uint64>(value.*Member) - static_cast<Uint64>(base.*Member)));
+    }
+    static void unpackDelta(BitReader& reader, Class& value, const Class& base) {
+        value.*Member = base.*Member;
+        if (reader.readBool()) value.*Member = static_cast<Type>(static_cast<Uint64>(base.*Member) + static_cast<Uint64>(reader.readSigned()));
+    }
+};
+
+// Float stored as a fixed-point step within [Min, Max], clamped. Lossy: the
+// decoded value is within half a step, (Max - Min) / (2^Bits - 1) / 2.
+template <auto Member, int Min, int Max, int Bits>
+struct PackQuantized {
+    typedef typename MemberOf<decltype(Member)>::Class Class;
+    static_assert(Min < Max && Bits >= 1 && Bits <= 24, "PackQuantized takes Min < Max and 1 to 24 bits");
+    static const Uint32 STEPS = (1u << Bits) - 1;
+
+    // In double: at 20+ bits a float product is off by a good part of a step.
+    static Uint32 quantize(float value) {
+        double t = (static_cast<double>(value) - Min) * (STEPS / static_cast<double>(Max - Min));
+        if (!(t > 0.0)) return 0;           // also catches NaN
+        if (t >= STEPS) return STEPS;
+        return static_cast<Uint32>(t + 0.5);
+    }
+    static float dequantize(Uint32 step) {
+        return static_cast<float>(Min + step * (static_cast<double>(Max - Min) / STEPS));
+    }
+
+    static void pack(BitWriter& writer, const Class& value) {
+        writer.writeBits(quantize(value.*Member), Bits);
+    }
+    static void unpack(BitReader& reader, Class& value) {
+        value.*Member = dequantize(reader.readBits(Bits));
+    }
+    static void packDelta(BitWriter& writer, const Class& value, const Class& base) {
+        Uint32 step = quantize(value.*Member);
+        Uint32 baseStep = quantize(base.*Member);
+        writer.writeBool(step != baseStep);
+        if (step != baseStep) writer.writeSigned(static_cast<Sint64>(step) - baseStep);
+    }
+    static void unpackDelta(BitReader& reader, Class& value, const Class& base) {
+        Sint64 step = quantize(base.*Member);
+        if (reader.readBool()) step += reader.readSigned();
+        value.*Member = dequantize(static_cast<Uint32>(step) & STEPS);
+    }
+};
+
+// Float stored exactly, 32 bits.
+template <auto Member>
+struct PackFloat {
+    typedef typename MemberOf<decltype(Member)>::Class Class;
+
+    static void pack(BitWriter& writer, const Class& value) {
+        Uint32 bits;
+        std::memcpy(&bits, &(value.*Member), sizeof(bits));
+        writer.writeBits(bits, 32);
+    }
+    static void unpack(BitReader& reader, Class& value) {
+        Uint32 bits = reader.readBits(32);
+        std::memcpy(&(value.*Member), &bits, sizeof(bits));
+    }
+    static void packDelta(BitWriter& writer, const Class& value, const Class& base) {
+        bool changed = std::memcmp(&(value.*Member), &(base.*Member), sizeof(float)) != 0;
+        writer.writeBool(changed);
+        if (changed) pack(writer, value);
+    }
+    static void unpackDelta(BitReader& reader, Class& value, const Class& base) {
+        if (reader.readBool()) unpack(reader, value);
+        else value.*Member = base.*Member;
+    }
+};
+
+// Length-prefixed string, cut to MaxLength bytes.
+template <auto Member, int MaxLength>
+struct PackString {
+    typedef typename MemberOf<decltype(Member)>::Class Class;
+
+    static void pack(BitWriter& writer, const Class& value) {
+        const std::string& text = value.*Member;
+        size_t length = text.size() < static_cast<size_t>(MaxLength) ? text.size() : MaxLength;
+        writer.writeVarint(length);
+        for (size_t i = 0; i < length; i++) {
+            writer.writeBits(static_cast<Uint8>(text[i]), 8);
+        }
+    }
+    static void unpack(BitReader& reader, Class& value) {
+        std::string& text = value.*Member;
+        Uint64 length = reader.readVarint();
+        text.resize(length < static_cast<Uint64>(MaxLength) ? static_cast<size_t>(length) : MaxLength);
+        for (char& c : text) {
+            c = static_cast<char>(reader.readBits(8));
+        }
+    }
+    static void packDelta(BitWriter& writer, const Class& value, const Class& base) {
+        bool changed = value.*Member != base.*Member;
+        writer.writeBool(changed);
+        if (changed) pack(writer, value);
+    }
+    static void unpackDelta(BitReader& reader, Class& value, const Class& base) {
+        if (reader.readBool()) unpack(reader, value);
+        else value.*Member = base.*Member;
+    }
+};
+
+// Member struct with its own Schema.
+template <auto Member>
+struct PackStruct {
+    typedef typename MemberOf<decltype(Member)>::Class Class;
+    typedef typename MemberOf<decltype(Member)>::Type Type;
+
+    static void pack(BitWriter& writer, const Class& value) {
+        Schema<Type>::Fields::pack(writer, value.*Member);
+    }
+    static void unpack(BitReader& reader, Class& value) {
+        Schema<Type>::Fields::unpack(reader, value.*Member);
+    }
+    static void packDelta(BitWriter& writer, const Class& value, const Class& base) {
+        Schema<Type>::Fields::packDelta(writer, value.*Member, base.*Member);
+    }
+    static void unpackDelta(BitReader& reader, Class& value, const Class& base) {
+        Schema<Type>::Fields::unpackDelta(reader, value.*Member, base.*Member);
+    }
+};
+
+template <typename... Fields>
+struct FieldList {
+    template <typename T>
+    static void pack(BitWriter& writer, const T& value) { (Fields::pack(writer, value), ...); }
+    template <typename T>
+    static void unpack(BitReader& reader, T& value) { (Fields::unpack(reader, value), ...); }
+    template <typename T>
+    static void packDelta(BitWriter& writer, const T& value, const T& base) { (Fields::packDelta(writer, value, base), ...); }
+    template <typename T>
+    static void unpackDelta(BitReader& reader, T& value, const T& base) { (Fields::unpackDelta(reader, value, base), ...); }
+};
+
+template <typename T>
+void packValue(BitWriter& writer, const T& value) {
+    Schema<T>::Fields::pack(writer, value);
+}
+
+template <typename T>
+void unpackValue(BitReader& reader, T& value) {
+    Schema<T>::Fields::unpack(reader, value);
+}
+
+template <typename T>
+void packDelta(BitWriter& writer, const T& value, const T& base) {
+    Schema<T>::Fields::packDelta(writer, value, base);
+}
+
+template <typename T>
+void unpackDelta(BitReader& reader, T& value, const T& base) {
+    Schema<T>::Fields::unpackDelta(reader, value, base);
+}
+
+template <typename T>
+void packArray(BitWriter& writer, const std::vector<T>& values) {
+    writer.writeVarint(values.size());
+    for (const T& value : values) {
+        packValue(writer, value);
+    }
+}
+
+// False if the stored count is over maxCount, which guards the allocation
+// against corrupt input.
+template <typename T>
+bool unpackArray(BitReader& reader, std::vector<T>& values, size_t maxCount) {
+    Uint64 count = reader.readVarint();
+    if (count > maxCount) return false;
+    values.resize(static_cast<size_t>(count));
+    for (T& value : values) {
+        unpackValue(reader, value);
+    }
+    return reader.ok();
+}
+
+// Elements are delta encoded against the baseline element at the same
+// index; any beyond the baseline's end are stored whole.
+template <typename T>
+void packArrayDelta(BitWriter& writer, const std::vector<T>& values, const std::vector<T>& base) {
+    writer.writeVarint(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i < base.size()) packDelta(writer, values[i], base[i]);
+        else packValue(writer, values[i]);
+    }
+}
+
+template <typename T>
+bool unpackArrayDelta(BitReader& reader, std::vector<T>& values, const std::vector<T>& base, size_t maxCount) {
+    Uint64 count = reader.readVarint();
+    if (count > maxCount) return false;
+    values.resize(static_cast<size_t>(count));
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i < base.size()) unpackDelta(reader, values[i], base[i]);
+        else unpackValue(reader, values[i]);
+    }
+    return reader.ok();
+}
+
+#endif // BIT_PACK_H
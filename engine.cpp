@@ -1,16 +1,23 @@
 ﻿#include "Engine.h"
-#include <iostream>
+#include "alloc_tracker.h"
+#include "log.h"
+#include "profile_zone.h"
 #include <algorithm>
 #include <sstream>
 #include <random>
 #include <fstream>
 #include <functional>
+#include <iterator>
 
 Engine::Engine()
     : isRunning(false),
     window(nullptr),
     renderer(nullptr),
     font(nullptr),
+    boldFont(nullptr),
+    loaderFont(nullptr),
+    loaderBoldFont(nullptr),
+    exitCode(0),
     rectX(100),
     rectY(100),
     rectWidth(200),
@@ -22,7 +29,6 @@ Engine::Engine()
     windowWidth(0),
     windowHeight(0),
     rectColor({ 255, 0, 0, 255 }),
-    showTextBox(false),
     inputText(""),
     snakeGameActive(false),
     snakeDirection(RIGHT),
@@ -31,13 +37,16 @@ Engine::Engine()
     gameOver(false),
     score(0),
     timer(120),
-    startTime(0),
     isPaused(false),
     frameCount(0),
-    lastFPSUpdateTime(0),
     fps(0),
     foodPosition({ 0, 0 }),
-    showHelp(false),
+    worldMode(false),
+    camera({ 0, 0, 0, 0 }),
+    tasks(timers),
+    hasLiveSnapshot(false),
+    rewindBuffer(4 * 1024 * 1024, 1024),
+    rewinding(false),
     backgroundColor({ 0, 0, 0, 255 }),
     velocityY(0.0f),
     bounceFactor(0.7f),
@@ -48,42 +57,72 @@ Engine::Engine()
     lastSnakeMoveTime(SDL_GetTicks()),
     currentMode(MODE_NONE),
     foodGoal(20),
-    askingForName(false),
-    showingScoreboard(false),
+    hudScore(0),
+    hudTimer(0),
+    hudRefreshFrame(0),
+    frameIndex(0),
+    sandboxScene(*this),
+    snakeScene(*this),
+    consoleScene(*this),
+    helpScene(*this),
+    nameEntryScene(*this),
+    scoreboardScene(*this),
+    mode1Scores(ScoreTable::fastestFirst),
+    mode2Scores(ScoreTable::mostFoodFirst),
+    savedScoreRow(0),
     showConfetti(false),
-    confettiStartTime(0) {
-    std::cout << "Engine object created." << std::endl;
+    pendingConfetti(0),
+    confettiRng(std::random_device()()) {
+    LOG_INFO("Engine object created.");
     loadScores();
+    registerMetrics();
+}
+
+void Engine::configure(const EngineOptions& engineOptions) {
+    options = engineOptions;
+    latency.setEnabled(options.latencyMode);
+    AllocTracker::setFrameBudget(options.allocBudget, options.allocByteBudget, options.allocWarmupFrames);
+    governor.setBudget(options.frameBudgetMs);
 }
 
 Engine::~Engine() {
     cleanup();
-    std::cout << "Engine object destroyed." << std::endl;
+    LOG_INFO("Engine object destroyed.");
 }
 
 bool Engine::initialize() {
+    if (options.headless) {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    }
+    if (!options.audioDriver.empty()) {
+        SDL_SetHint(SDL_HINT_AUDIODRIVER, options.audioDriver.c_str());
+    }
+    else if (options.headless) {
+        SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        std::cerr << "SDL could not initialize: " << SDL_GetError() << std::endl;
+        LOG_ERROR("SDL could not initialize: {}", SDL_GetError());
         return false;
     }
 
     if (TTF_Init() == -1) {
-        std::cerr << "TTF could not initialize: " << TTF_GetError() << std::endl;
+        LOG_ERROR("TTF could not initialize: {}", TTF_GetError());
         SDL_Quit();
         return false;
     }
 
     window = SDL_CreateWindow("2D Game Engine", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1024, 800, SDL_WINDOW_SHOWN);
     if (!window) {
-        std::cerr << "Window could not be created: " << SDL_GetError() << std::endl;
+        LOG_ERROR("Window could not be created: {}", SDL_GetError());
         TTF_Quit();
         SDL_Quit();
         return false;
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window, -1, options.headless ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED);
     if (!renderer) {
-        std::cerr << "Renderer could not be created: " << SDL_GetError() << std::endl;
+        LOG_ERROR("Renderer could not be created: {}", SDL_GetError());
         SDL_DestroyWindow(window);
         TTF_Quit();
         SDL_Quit();
@@ -92,8 +131,8 @@ bool Engine::initialize() {
 
     font = TTF_OpenFont("fonts/arial.ttf", 24);
     if (!font) {
-        std::cerr << "Font could not be loaded: " << TTF_GetError() << std::endl;
-        std::cerr << "Font path: fonts/arial.ttf" << std::endl;
+        LOG_ERROR("Font could not be loaded: {}", TTF_GetError());
+        LOG_ERROR("Font path: fonts/arial.ttf");
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
         TTF_Quit();
@@ -101,266 +140,316 @@ bool Engine::initialize() {
         return false;
     }
 
+    boldFont = TTF_OpenFont("fonts/arial.ttf", 24);
+    if (boldFont) {
+        TTF_SetFontStyle(boldFont, TTF_STYLE_BOLD);
+    }
+    else {
+        boldFont = font;
+    }
+    loaderFont = TTF_OpenFont("fonts/arial.ttf", 24);
+    loaderBoldFont = loaderFont;
+    if (boldFont != font) {
+        loaderBoldFont = TTF_OpenFont("fonts/arial.ttf", 24);
+        if (loaderBoldFont) TTF_SetFontStyle(loaderBoldFont, TTF_STYLE_BOLD);
+    }
+
+    textCache.resize(64);
+    for (auto& entry : textCache) {
+        entry.text.reserve(128);
+        entry.font = nullptr;
+        entry.color = { 0, 0, 0, 0 };
+        entry.texture = nullptr;
+        entry.width = entry.height = 0;
+        entry.lastUsedFrame = 0;
+    }
+
+    // The game still runs without sound if no audio device is available.
+    audio.open(options.audioLowLatency);
+
+    if (options.softRaster) {
+        raster.open(renderer, options.rasterThreads);
+    }
+
+    if (options.spectatorPort > 0) {
+        spectators.open(static_cast<Uint16>(options.spectatorPort));
+    }
+
+    if (options.metricsPort > 0 || !options.metricsFile.empty()) {
+        metricsExporter.start(metrics, static_cast<Uint16>(options.metricsPort), options.metricsFile, 10000);
+    }
+
+    if (!options.capturePath.empty()) {
+        capture.open(options.capturePath);
+    }
+
     SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+    updateCamera();
+
+    timers.reset(SDL_GetTicks());
+    timers.schedule(1000, [this] {
+        fps = frameCount;
+        fpsMetric.set(fps);
+        frameCount = 0;
+    }, 1000);
+
+    if (options.injectInputMs > 0) {
+        inputInjector.start(options.injectInputMs);
+    }
+
+    scenes.start();
+    scenes.push(&sandboxScene);
+    scoreWriter.start("scores.txt", scoreSaveMetric);
 
     isRunning = true;
-    std::cout << "Graphics library initialized." << std::endl;
+    LOG_INFO("Graphics library initialized.");
     return true;
 }
 
 void Engine::cleanup() {
+    if (audio.isOpen()) {
+        AudioMixer::Stats stats = audio.stats();
+        LOG_INFO("Audio: {} sounds played, {} dropped, {} voices stolen, {} callbacks",
+            stats.commandsPlayed, stats.commandsDropped, stats.voicesStolen, stats.callbacks);
+        audio.close();
+    }
+    TaskScheduler::Stats taskStats = tasks.stats();
+    LOG_INFO("Tasks: {} peak, {} resumes, {} KB frame pool", taskStats.peakTasks, taskStats.resumes, taskStats.frameBytes / 1024);
+    tasks.cancelAll();
+    scenes.stop();
+    scoreWriter.stop();
+    metricsExporter.stop();
+    if (spectators.isOpen()) {
+        SpectatorRelay::Stats stats = spectators.stats();
+        LOG_INFO("Spectators: {} joined, {} dropped, {} resyncs, {} KB sent for {} ticks",
+            stats.subscribersJoined, stats.subscribersDropped, stats.resyncs, stats.bytesSent / 1024, stats.ticksPublished);
+        spectators.close();
+    }
+    if (capture.isActive()) {
+        capture.close();
+        FrameCapture::Stats stats = capture.stats();
+        double readbackMs = stats.framesCaptured > stats.framesDropped ? stats.readbackMs / (stats.framesCaptured - stats.framesDropped) : 0.0;
+        LOG_INFO("Capture: {} frames written, {} dropped, {} screenshots, {} KB ({}% of raw), {} ms readback per frame",
+            stats.framesWritten, stats.framesDropped, stats.screenshots, stats.bytesWritten / 1024,
+            stats.rawBytes ? 100.0 * stats.bytesWritten / stats.rawBytes : 0.0, readbackMs);
+    }
+    raster.close();
+    clearTextCache();
     if (renderer) SDL_DestroyRenderer(renderer);
     if (window) SDL_DestroyWindow(window);
+    if (boldFont && boldFont != font) TTF_CloseFont(boldFont);
     if (font) TTF_CloseFont(font);
+    if (loaderBoldFont && loaderBoldFont != loaderFont) TTF_CloseFont(loaderBoldFont);
+    if (loaderFont) TTF_CloseFont(loaderFont);
+    renderer = nullptr;
+    window = nullptr;
+    boldFont = nullptr;
+    font = nullptr;
+    loaderBoldFont = nullptr;
+    loaderFont = nullptr;
     TTF_Quit();
     SDL_Quit();
 }
 
 void Engine::run() {
+    if (options.stallThresholdMs > 0.0) {
+        watchdog.start(options.stallThresholdMs, options.stallReport);
+    }
     while (isRunning) {
+        frameArena.reset();
+        frameIndex++;
+        watchdog.heartbeat(frameIndex);
+        AllocTracker::beginFrame();
+        if (inputInjector.isActive()) {
+            driveInjectedGame();
+        }
+        if (options.stress) {
+            driveStress();
+        }
+        Uint64 frameStart = SDL_GetPerformanceCounter();
         handleEvents();
         update();
         render();
+        double frameMs = (SDL_GetPerformanceCounter() - frameStart) * 1000.0 / SDL_GetPerformanceFrequency();
+        governor.onFrame(frameMs);
+        recordFrameMetrics(frameMs);
+        endFrameAllocations();
+        if (options.frameLimit > 0 && static_cast<int>(frameIndex) >= options.frameLimit) {
+            isRunning = false;
+        }
         SDL_Delay(16);
     }
+    if (watchdog.isRunning()) {
+        watchdog.stop();
+        StallWatchdog::Stats stats = watchdog.stats();
+        LOG_INFO("Stall watchdog: {} stalled frames, worst {} ms", stats.stalls, stats.worstMs);
+    }
+
+    // Reports are multi-line; each goes out as one message.
+    if (AllocTracker::enabled()) {
+        std::ostringstream report;
+        AllocTracker::report(report);
+        LOG_INFO("{}", report.str());
+    }
+    if (latency.isEnabled()) {
+        std::ostringstream report;
+        latency.report(report);
+        LOG_INFO("{}", report.str());
+        if (!options.latencyOut.empty() && !latency.writeCsv(options.latencyOut)) {
+            LOG_ERROR("Could not write latency report to {}", options.latencyOut);
+        }
+    }
+    if (options.stress) {
+        std::ostringstream report;
+        governor.report(report);
+        LOG_INFO("{}", report.str());
+        if (options.headless && governor.overBudgetFraction() > 0.05) {
+            LOG_ERROR("Frame budget not held under stress");
+            exitCode = 1;
+        }
+    }
+}
+
+void Engine::registerMetrics() {
+    metrics.add("engine_frame_time_ms", "Work time per frame (events, update, render) in milliseconds.", frameTimeMetric);
+    metrics.add("engine_frames_total", "Frames run.", framesMetric);
+    metrics.add("engine_fps", "Frames in the last second.", fpsMetric);
+    metrics.add("snake_sim_ticks_total", "Snake simulation steps.", simTicksMetric);
+    metrics.add("snake_length_cells", "Current snake length in cells.", snakeLengthMetric);
+    metrics.add("confetti_particles", "Live confetti particles.", particlesMetric);
+    metrics.add("spectators", "Connected spectators.", spectatorsMetric);
+    metrics.add("score_save_ms", "Time to write scores.txt in milliseconds.", scoreSaveMetric);
+    if (AllocTracker::enabled()) {
+        metrics.add("heap_allocations_total", "Heap allocations made by the engine.", allocationsMetric);
+        metrics.add("heap_allocated_bytes_total", "Bytes allocated by the engine.", allocatedBytesMetric);
+        metrics.add("heap_live_bytes", "Heap bytes currently allocated.", liveHeapMetric);
+    }
+}
+
+void Engine::recordFrameMetrics(double frameMs) {
+    frameTimeMetric.observe(frameMs);
+    framesMetric.add();
+    snakeLengthMetric.set(static_cast<double>(snakeBody.length()));
+    particlesMetric.set(static_cast<double>(confettiParticles.size()));
+    spectatorsMetric.set(spectators.subscriberCount());
+}
+
+void Engine::driveInjectedGame() {
+    // Keep a Mode 2 game running so injected steering always has a target.
+    if (!snakeGameActive || gameOver) {
+        resetSnakeGame();
+        inputText = "";
+        startSnakeGame(MODE_2);
+    }
+    inputInjector.update();
+}
+
+void Engine::startStressScenario() {
+    resetSnakeGame();
+    inputText = "";
+    startSnakeGame(MODE_2);
+
+    // A long random walk of short runs over the whole window. The game stays
+    // paused, so the snake never dies and only rendering is measured.
+    const int runCount = 50000;
+    int cellsX = windowWidth / SnakeBody::CELL_PIXELS - 3;
+    int cellsY = windowHeight / SnakeBody::CELL_PIXELS - 3;
+    std::vector<SnakeRun> runs;
+    runs.reserve(runCount);
+    std::mt19937 gen(12345);
+    int x = cellsX / 2, y = cellsY / 2;
+    Direction direction = RIGHT;
+    runs.push_back({ static_cast<Sint32>(x), static_cast<Sint32>(y), 1, static_cast<Uint16>(direction) });
+    while (static_cast<int>(runs.size()) < runCount) {
+        bool horizontal = direction == LEFT || direction == RIGHT;
+        direction = horizontal ? (gen() & 1 ? UP : DOWN) : (gen() & 1 ? LEFT : RIGHT);
+        int dx = direction == LEFT ? -1 : direction == RIGHT ? 1 : 0;
+        int dy = direction == UP ? -1 : direction == DOWN ? 1 : 0;
+        int room = dx > 0 ? cellsX - x : dx < 0 ? x : dy > 0 ? cellsY - y : y;
+        if (room < 2) {
+            direction = static_cast<Direction>(direction ^ 1);   // UP<->DOWN, LEFT<->RIGHT
+            dx = -dx;
+            dy = -dy;
+            room = dx > 0 ? cellsX - x : dx < 0 ? x : dy > 0 ? cellsY - y : y;
+        }
+        int length = std::max(1, std::min(room, 2 + static_cast<int>(gen() % 30)));
+        runs.push_back({ static_cast<Sint32>(x + dx), static_cast<Sint32>(y + dy), static_cast<Uint16>(length), static_cast<Uint16>(direction) });
+        x += dx * length;
+        y += dy * length;
+    }
+    snakeBody.assign(runs.data(), runs.size(), 0);
+    isPaused = true;
+    scheduleSnakeStep();
+}
+
+void Engine::driveStress() {
+    if (!snakeGameActive) {
+        startStressScenario();
+    }
+    if (frameIndex % 30 == 0) {
+        startConfetti(5000);
+    }
+    // Measure the second half, after the governor has had time to settle.
+    Uint32 settleFrame = options.frameLimit > 0 ? options.frameLimit / 2 : 600;
+    if (frameIndex == settleFrame) {
+        governor.resetStats();
+    }
+}
+
+void Engine::endFrameAllocations() {
+    if (!AllocTracker::enabled()) return;
+
+    AllocTracker::trackBuffer("snakeBody", snakeBody.memoryBytes());
+    AllocTracker::trackBuffer("confettiParticles", confettiParticles.capacity() * sizeof(Confetti));
+    AllocTracker::trackBuffer("mode1Scores", mode1Scores.memoryBytes());
+    AllocTracker::trackBuffer("mode2Scores", mode2Scores.memoryBytes());
+
+    AllocTracker::FrameStats stats = AllocTracker::endFrame();
+    allocationsMetric.add(stats.allocations);
+    allocatedBytesMetric.add(stats.bytes);
+    liveHeapMetric.set(static_cast<double>(AllocTracker::liveBytes()));
+    if (AllocTracker::overBudget(stats)) {
+        std::ostringstream report;
+        AllocTracker::reportFrame(report);
+        LOG_WARN("Allocation budget exceeded ({} allocations, {} bytes per frame)\n{}",
+            options.allocBudget, options.allocByteBudget, report.str());
+        if (options.headless) {
+            exitCode = 1;
+            isRunning = false;
+        }
+    }
 }
 
 void Engine::handleEvents() {
+    PROFILE_ZONE("handleEvents");
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) {
             isRunning = false;
         }
         if (event.type == SDL_KEYDOWN) {
-            handleKeyPress(event.key.keysym.sym);
+            SDL_Keycode key = event.key.keysym.sym;
+            if (key == SDLK_F12) {
+                capture.requestScreenshot("screenshot-" + std::to_string(frameIndex) + ".bmp");
+                continue;
+            }
+            if (scenes.top() == &snakeScene && (key == SDLK_UP || key == SDLK_DOWN || key == SDLK_LEFT || key == SDLK_RIGHT)) {
+                latency.onInput(event.key.timestamp);
+            }
+            scenes.keyDown(key);
         }
         if (event.type == SDL_KEYUP) {
-            handleKeyRelease(event.key.keysym.sym);
+            scenes.keyUp(event.key.keysym.sym);
         }
-        if (event.type == SDL_MOUSEMOTION && !gravityMode) {
-            handleMouseMotion(event.motion.x, event.motion.y);
+        if (event.type == SDL_MOUSEMOTION) {
+            scenes.mouseMotion(event.motion.x, event.motion.y);
         }
         if (event.type == SDL_MOUSEWHEEL) {
-            handleMouseWheel(event.wheel.y);
+            scenes.mouseWheel(event.wheel.y);
         }
     }
 }
 
-void Engine::handleKeyPress(SDL_Keycode key) {
-    if (showTextBox) {
-        switch (key) {
-        case SDLK_BACKSPACE:
-            if (!inputText.empty()) {
-                inputText.pop_back();
-            }
-            break;
-        case SDLK_RETURN:
-            if (askingForName) {
-                if (!inputText.empty()) {
-                    saveScore();
-                    askingForName = false;
-                    showTextBox = false;
-                    showingScoreboard = true;
-                    if (currentMode == MODE_1 && !mode1Scores.empty() && score == 20 && (120 - timer) < mode1Scores[0].time) {
-                        showConfetti = true;
-                        confettiStartTime = SDL_GetTicks();
-                        confettiParticles.clear();
-                        std::random_device rd;
-                        std::mt19937 gen(rd());
-                        std::uniform_int_distribution<> disX(0, windowWidth);
-                        std::uniform_int_distribution<> disY(0, windowHeight);
-                        std::uniform_int_distribution<> disColor(0, 255);
-                        for (int i = 0; i < 50; ++i) {
-                            Confetti particle;
-                            particle.x = static_cast<float>(disX(gen));
-                            particle.y = static_cast<float>(disY(gen));
-                            particle.color = { static_cast<Uint8>(disColor(gen)), static_cast<Uint8>(disColor(gen)), static_cast<Uint8>(disColor(gen)), 255 };
-                            particle.velocityX = (static_cast<float>(disX(gen) - windowWidth / 2) / 100.0f) * 2.0f;
-                            particle.velocityY = -5.0f + (static_cast<float>(disY(gen)) / 100.0f) * 2.0f;
-                            confettiParticles.push_back(particle);
-                        }
-                    }
-                    else if (currentMode == MODE_2 && (mode2Scores.empty() || score > mode2Scores[0].food)) {
-                        showConfetti = true;
-                        confettiStartTime = SDL_GetTicks();
-                        confettiParticles.clear();
-                        std::random_device rd;
-                        std::mt19937 gen(rd());
-                        std::uniform_int_distribution<> disX(0, windowWidth);
-                        std::uniform_int_distribution<> disY(0, windowHeight);
-                        std::uniform_int_distribution<> disColor(0, 255);
-                        for (int i = 0; i < 50; ++i) {
-                            Confetti particle;
-                            particle.x = static_cast<float>(disX(gen));
-                            particle.y = static_cast<float>(disY(gen));
-                            particle.color = { static_cast<Uint8>(disColor(gen)), static_cast<Uint8>(disColor(gen)), static_cast<Uint8>(disColor(gen)), 255 };
-                            particle.velocityX = (static_cast<float>(disX(gen) - windowWidth / 2) / 100.0f) * 2.0f;
-                            particle.velocityY = -5.0f + (static_cast<float>(disY(gen)) / 100.0f) * 2.0f;
-                            confettiParticles.push_back(particle);
-                        }
-                    }
-                }
-            }
-            else if (showingScoreboard) {
-                showingScoreboard = false;
-                showConfetti = false;
-                confettiParticles.clear();
-                resetSnakeGame();
-            }
-            else if (inputText.find("background is ") == 0) {
-                std::string colorName = inputText.substr(14);
-                setBackgroundColor(colorName);
-                showTextBox = false;
-                inputText = "";
-            }
-            else if (inputText == "play mode1") {
-                startSnakeGame(MODE_1);
-                showTextBox = false;
-                inputText = "";
-            }
-            else if (inputText == "play mode2") {
-                startSnakeGame(MODE_2);
-                showTextBox = false;
-                inputText = "";
-            }
-            else if (inputText.find("play mode3") == 0) {
-                int customTime = 120;
-                int customFoodGoal = 20;
-                std::string args = inputText.substr(10);
-                std::istringstream iss(args);
-                std::string token;
-
-                while (iss >> token) {
-                    if (token == "time" && iss >> customTime) {}
-                    else if (token == "food" && iss >> customFoodGoal) {}
-                }
-                startSnakeGame(MODE_3, customTime, customFoodGoal);
-                showTextBox = false;
-                inputText = "";
-            }
-            else if (inputText == "help") {
-                showHelp = true;
-                inputText = "";
-            }
-            else if (inputText == "restart") {
-                resetSnakeGame();
-                startSnakeGame(currentMode, timer, foodGoal);
-                showTextBox = false;
-                inputText = "";
-            }
-            break;
-        case SDLK_x:
-            if (showingScoreboard) {
-                showingScoreboard = false;
-                showConfetti = false;
-                confettiParticles.clear();
-                resetSnakeGame();
-            }
-            else {
-                resetSnakeGame();
-                showTextBox = false;
-                showHelp = false;
-                askingForName = false;
-                inputText = "";
-            }
-            break;
-        case SDLK_f:
-            toggleFullscreen();
-            showTextBox = false;
-            inputText = "";
-            break;
-        default:
-            if (key >= 32 && key <= 126) {
-                if (inputText.length() < 20) {
-                    inputText += static_cast<char>(key);
-                }
-            }
-            break;
-        }
-    }
-    else {
-        switch (key) {
-        case SDLK_UP:
-            if (snakeDirection != DOWN) {
-                snakeDirection = UP;
-                snakeSpeed = snakeBoostedSpeed;
-            }
-            break;
-        case SDLK_DOWN:
-            if (snakeDirection != UP) {
-                snakeDirection = DOWN;
-                snakeSpeed = snakeBoostedSpeed;
-            }
-            break;
-        case SDLK_LEFT:
-            if (snakeDirection != RIGHT) {
-                snakeDirection = LEFT;
-                snakeSpeed = snakeBoostedSpeed;
-            }
-            break;
-        case SDLK_RIGHT:
-            if (snakeDirection != LEFT) {
-                snakeDirection = RIGHT;
-                snakeSpeed = snakeBoostedSpeed;
-            }
-            break;
-        case SDLK_e:
-            if (!snakeGameActive) {
-                toggleGravityMode("Earth Gravity is on", "Earth Gravity is off", 0.1f, 0.8f);
-            }
-            break;
-        case SDLK_m:
-            if (!snakeGameActive) {
-                toggleGravityMode("Moon Gravity is on", "Moon Gravity is off", 0.1f, 0.13f);
-            }
-            break;
-        case SDLK_r:
-            if (!snakeGameActive) {
-                rectColor = { 255, 0, 0, 255 };
-            }
-            break;
-        case SDLK_g:
-            if (!snakeGameActive) {
-                rectColor = { 0, 255, 0, 255 };
-            }
-            break;
-        case SDLK_b:
-            if (!snakeGameActive) {
-                rectColor = { 0, 0, 255, 255 };
-            }
-            break;
-        case SDLK_c:
-            showTextBox = true;
-            showHelp = false;
-            break;
-        case SDLK_s:
-            if (snakeGameActive) {
-                isPaused = !isPaused;
-            }
-            break;
-        case SDLK_x:
-            if (snakeGameActive || showTextBox || showHelp) {
-                resetSnakeGame();
-                showTextBox = false;
-                showHelp = false;
-                inputText = "";
-            }
-            break;
-        }
-    }
-}
-
-void Engine::handleKeyRelease(SDL_Keycode key) {
-    switch (key) {
-    case SDLK_UP:
-    case SDLK_DOWN:
-    case SDLK_LEFT:
-    case SDLK_RIGHT:
-        snakeSpeed = 2;
-        break;
-    }
-}
-
 void Engine::handleMouseMotion(int mouseX, int mouseY) {
     rectX = mouseX - rectWidth / 2;
     rectY = mouseY - rectHeight / 2;
@@ -392,6 +481,7 @@ void Engine::toggleFullscreen() {
         SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN_DESKTOP);
     }
     SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+    updateCamera();
 }
 
 void Engine::toggleGravityMode(const std::string& onText, const std::string& offText, float speed, float acceleration) {
@@ -408,12 +498,10 @@ void Engine::startSnakeGame(GameMode mode, int customTime, int customFoodGoal) {
     snakeGameActive = true;
     gameOver = false;
     isPaused = false;
-    askingForName = false;
-    showingScoreboard = false;
     showConfetti = false;
     confettiParticles.clear();
-    snakeBody.clear();
-    snakeBody.push_back({ windowWidth / 2, windowHeight / 2 });
+    clearRewindHistory();
+    snakeBody.reset((arenaWidth() / 2) / World::CELL_SIZE * World::CELL_SIZE, (arenaHeight() / 2) / World::CELL_SIZE * World::CELL_SIZE, RIGHT);
     snakeDirection = RIGHT;
     snakeSpeed = 2;
     snakeBoostedSpeed = 4;
@@ -434,22 +522,49 @@ void Engine::startSnakeGame(GameMode mode, int customTime, int customFoodGoal) {
         foodGoal = customFoodGoal;
     }
 
-    startTime = SDL_GetTicks() / 1000;
     lastSnakeMoveTime = SDL_GetTicks();
+    scheduleSnakeStep();
+    scheduleCountdown(1000);
+    timers.cancel(confettiTimer);
+    tasks.cancel(gameOverTask);
+    updateCamera();
+    scenes.popTo(&sandboxScene);
+    scenes.push(&snakeScene);
+}
+
+void Engine::startWorldGame(int worldSizeCells) {
+    worldSizeCells = std::max(World::CHUNK_CELLS, std::min(SnakeBody::MAX_CELLS, worldSizeCells));
+    world.open(worldSizeCells, worldSizeCells, static_cast<Uint32>(rand()));
+    worldMode = true;
+    startSnakeGame(MODE_2);
+    LOG_INFO("World opened: {}x{} cells", worldSizeCells, worldSizeCells);
+}
+
+void Engine::updateCamera() {
+    if (!worldMode || snakeBody.empty()) {
+        camera = { 0, 0, windowWidth, windowHeight };
+        return;
+    }
+
+    camera.w = windowWidth;
+    camera.h = windowHeight;
+    camera.x = std::max(0, std::min(world.pixelWidth() - windowWidth, snakeBody.head().x - windowWidth / 2));
+    camera.y = std::max(0, std::min(world.pixelHeight() - windowHeight, snakeBody.head().y - windowHeight / 2));
 }
 
 void Engine::updateSnakeGame() {
+    PROFILE_ZONE("updateSnakeGame");
     if (!snakeGameActive || gameOver || isPaused) return;
 
-    Uint32 currentTime = SDL_GetTicks();
-    Uint32 moveInterval = (snakeSpeed == snakeBoostedSpeed) ? 20 : 40;
-    if (currentTime - lastSnakeMoveTime < moveInterval) return;
-    lastSnakeMoveTime = currentTime;
+    lastSnakeMoveTime = SDL_GetTicks();
+    simTicksMetric.add();
+    latency.onSimStep();
 
-    int newX = snakeBody[0].x;
-    int newY = snakeBody[0].y;
+    SDL_Point head = snakeBody.head();
+    int newX = head.x;
+    int newY = head.y;
 
-    int stepSize = 4;
+    int stepSize = SnakeBody::CELL_PIXELS;
     switch (snakeDirection) {
     case UP: newY -= stepSize; break;
     case DOWN: newY += stepSize; break;
@@ -457,179 +572,254 @@ void Engine::updateSnakeGame() {
     case RIGHT: newX += stepSize; break;
     }
 
-    snakeBody.insert(snakeBody.begin(), { newX, newY });
+    // Checked before moving, so body cells never leave the arena.
+    if (newX < 0 || newX >= arenaWidth() || newY < 0 || newY >= arenaHeight()) {
+        endSnakeGame();
+        return;
+    }
 
-    if (abs(newX - foodPosition.x) < 10 && abs(newY - foodPosition.y) < 10) {
-        foodPosition = { rand() % (windowWidth - 10), rand() % (windowHeight - 10) };
+    snakeBody.extendHead(snakeDirection);
+
+    if (worldMode) {
+        if (world.consumeFoodNear(newX, newY, 10)) {
+            score++;
+        }
+        else {
+            snakeBody.trimTail();
+        }
+    }
+    else if (abs(newX - foodPosition.x) < 10 && abs(newY - foodPosition.y) < 10) {
+        spawnFood();
         score++;
     }
     else {
-        snakeBody.pop_back();
+        snakeBody.trimTail();
     }
 
-    if (newX < 0 || newX >= windowWidth || newY < 0 || newY >= windowHeight) {
-        gameOver = true;
-        if (currentMode != MODE_3) {
-            askingForName = true;
-            showTextBox = true;
-            inputText = "";
-        }
+    if (snakeBody.hitsBody(newX, newY)) {
+        endSnakeGame();
         return;
     }
 
-    for (size_t i = 1; i < snakeBody.size(); i++) {
-        if (newX == snakeBody[i].x && newY == snakeBody[i].y) {
-            gameOver = true;
-            if (currentMode != MODE_3) {
-                askingForName = true;
-                showTextBox = true;
-                inputText = "";
-            }
-            return;
-        }
-    }
-
     if (currentMode != MODE_2) {
-        int currentTimeSec = SDL_GetTicks() / 1000;
-        timer = (currentMode == MODE_1 || currentMode == MODE_3) ? (timer - (currentTimeSec - startTime)) : timer;
-        startTime = currentTimeSec;
-
         if (score >= foodGoal) {
-            gameOver = true;
-            if (currentMode != MODE_3) {
-                askingForName = true;
-                showTextBox = true;
-                inputText = "";
-            }
+            endSnakeGame();
             return;
         }
         else if (timer <= 0) {
-            gameOver = true;
-            if (currentMode != MODE_3) {
-                askingForName = true;
-                showTextBox = true;
-                inputText = "";
-            }
+            endSnakeGame();
+            return;
+        }
+    }
+}
+
+// Arms the next snake step from the time of the last one, so speed changes
+// take effect without waiting out the old interval.
+void Engine::scheduleSnakeStep() {
+    timers.cancel(snakeStepTimer);
+    if (!snakeGameActive || gameOver || isPaused || rewinding) return;
+
+    Uint32 moveInterval = (snakeSpeed == snakeBoostedSpeed) ? 20 : 40;
+    Sint32 wait = static_cast<Sint32>(lastSnakeMoveTime + moveInterval - static_cast<Uint32>(timers.now()));
+    snakeStepTimer = timers.schedule(wait > 0 ? wait : 0, [this] {
+        updateSnakeGame();
+        scheduleSnakeStep();
+    });
+}
+
+void Engine::scheduleCountdown(Uint32 firstTickMs) {
+    timers.cancel(countdownTimer);
+    if (!snakeGameActive || gameOver || (currentMode != MODE_1 && currentMode != MODE_3)) return;
+
+    countdownTimer = timers.schedule(firstTickMs, [this] {
+        if (gameOver) {
+            timers.cancel(countdownTimer);
             return;
         }
+        timer--;
+    }, 1000);
+}
+
+void Engine::endSnakeGame() {
+    gameOver = true;
+    if (currentMode != MODE_3) {
+        tasks.cancel(gameOverTask);
+        gameOverTask = tasks.start(gameOverSequence());
+    }
+}
+
+Task Engine::gameOverSequence() {
+    scenes.push(&nameEntryScene);
+    co_await tasks.wait(nameEntered);
+
+    saveScore();
+    // Name entry stays up until the scoreboard has its rows rendered.
+    scenes.preload(&scoreboardScene);
+    scenes.replaceTop(&scoreboardScene);
+    if ((currentMode == MODE_1 && !mode1Scores.empty() && score == 20 && (120 - timer) < mode1Scores[0].time) ||
+        (currentMode == MODE_2 && (mode2Scores.empty() || score > mode2Scores[0].food))) {
+        PROFILE_ZONE("confetti");
+        startConfetti();
     }
 }
 
+void Engine::startConfetti(int count) {
+    showConfetti = true;
+    startConfettiTimer(2000);
+    confettiParticles.clear();
+    pendingConfetti = count;
+    emitConfetti();
+    audio.play(SOUND_CELEBRATE);
+}
+
+// Spawns queued particles within the quality level's rate and count caps.
+void Engine::emitConfetti() {
+    const QualitySettings& quality = governor.settings();
+    int room = quality.maxConfetti - static_cast<int>(confettiParticles.size());
+    int count = std::min(pendingConfetti, std::min(quality.confettiPerFrame, std::max(0, room)));
+    pendingConfetti = room > 0 ? pendingConfetti - count : 0;
+
+    std::uniform_int_distribution<> disX(0, windowWidth);
+    std::uniform_int_distribution<> disY(0, windowHeight);
+    std::uniform_int_distribution<> disColor(0, 255);
+    for (int i = 0; i < count; ++i) {
+        Confetti particle;
+        particle.x = static_cast<float>(disX(confettiRng));
+        particle.y = static_cast<float>(disY(confettiRng));
+        particle.color = { static_cast<Uint8>(disColor(confettiRng)), static_cast<Uint8>(disColor(confettiRng)), static_cast<Uint8>(disColor(confettiRng)), 255 };
+        particle.velocityX = (static_cast<float>(disX(confettiRng) - windowWidth / 2) / 100.0f) * 2.0f;
+        particle.velocityY = -5.0f + (static_cast<float>(disY(confettiRng)) / 100.0f) * 2.0f;
+        confettiParticles.push_back(particle);
+    }
+}
+
+void Engine::startConfettiTimer(Uint32 durationMs) {
+    timers.cancel(confettiTimer);
+    confettiTimer = timers.schedule(durationMs, [this] {
+        showConfetti = false;
+        confettiParticles.clear();
+    });
+}
+
 void Engine::renderSnakeGame() {
     if (!snakeGameActive) return;
+    PROFILE_ZONE("renderSnakeGame");
 
-    for (size_t i = 0; i < snakeBody.size(); i++) {
-        Uint8 greenValue = static_cast<Uint8>(255 - (i * 100 / static_cast<int>(std::max<size_t>(1, snakeBody.size()))));
-        SDL_SetRenderDrawColor(renderer, 0, greenValue, 0, 255);
-        SDL_Rect rect;
-        if (i == 0) {
-            rect = { snakeBody[i].x - 2, snakeBody[i].y - 2, 16, 16 };
+    // Everything below is in world coordinates; skip what the camera can't see.
+    auto cullAndOffset = [this](SDL_Rect& rect) {
+        if (rect.x >= camera.x + camera.w || rect.x + rect.w <= camera.x ||
+            rect.y >= camera.y + camera.h || rect.y + rect.h <= camera.y) {
+            return false;
+        }
+        rect.x -= camera.x;
+        rect.y -= camera.y;
+        return true;
+    };
+
+    const QualitySettings& quality = governor.settings();
+    size_t runCount = snakeBody.runCount();
+    if (quality.snakeOutline) {
+        // Cheapest: a 1-pixel line through the run corners.
+        ArenaVector<SDL_Point> points{ ArenaAllocator<SDL_Point>(frameArena) };
+        points.reserve(runCount + 1);
+        if (runCount > 0) {
+            SDL_Point tail = snakeBody.runTail(0);
+            points.push_back({ tail.x + 6 - camera.x, tail.y + 6 - camera.y });
         }
-        else if (i == static_cast<size_t>(snakeBody.size() - 1)) {
-            rect = { snakeBody[i].x + 2, snakeBody[i].y + 2, 8, 8 };
+        for (size_t i = 0; i < runCount; i++) {
+            SDL_Point end = snakeBody.runHead(i);
+            points.push_back({ end.x + 6 - camera.x, end.y + 6 - camera.y });
+        }
+        if (raster.isOpen()) {
+            // The rasterizer only fills; every segment is axis-aligned, so it
+            // becomes a 1-pixel-wide rect.
+            for (size_t i = 1; i < points.size(); i++) {
+                SDL_Point a = points[i - 1];
+                SDL_Point b = points[i];
+                SDL_Rect segment = { std::min(a.x, b.x), std::min(a.y, b.y), abs(a.x - b.x) + 1, abs(a.y - b.y) + 1 };
+                raster.fillRect(segment, { 0, 200, 0, 255 });
+            }
         }
         else {
-            rect = { snakeBody[i].x, snakeBody[i].y, 12, 12 };
+            SDL_SetRenderDrawColor(renderer, 0, 200, 0, 255);
+            SDL_RenderDrawLines(renderer, points.data(), static_cast<int>(points.size()));
         }
-        SDL_RenderFillRect(renderer, &rect);
-
-        if (i < snakeBody.size() - 1) {
-            int x1 = snakeBody[i].x;
-            int y1 = snakeBody[i].y;
-            int x2 = snakeBody[i + 1].x;
-            int y2 = snakeBody[i + 1].y;
-
-            if (x1 == x2) {
-                SDL_Rect connector = { x1, std::min(y1, y2), 12, static_cast<int>(abs(y1 - y2)) + 12 };
-                SDL_RenderFillRect(renderer, &connector);
+    }
+    else {
+        // One quad per straight run, shaded by how far its middle is from the
+        // head, or submitted as a single flat-colored batch at lower quality.
+        ArenaVector<SDL_Rect> batch{ ArenaAllocator<SDL_Rect>(frameArena) };
+        if (!quality.snakeGradient) batch.reserve(runCount);
+        size_t fromHead = 0;
+        size_t totalCells = std::max<size_t>(1, snakeBody.length());
+        for (size_t i = runCount; i-- > 0;) {
+            SDL_Point tail = snakeBody.runTail(i);
+            SDL_Point end = snakeBody.runHead(i);
+            SDL_Rect rect = { std::min(tail.x, end.x), std::min(tail.y, end.y), abs(tail.x - end.x) + 12, abs(tail.y - end.y) + 12 };
+            size_t length = snakeBody.run(i).length;
+            Uint8 greenValue = static_cast<Uint8>(255 - ((fromHead + length / 2) * 100 / totalCells));
+            fromHead += length;
+            if (!cullAndOffset(rect)) continue;
+            if (quality.snakeGradient) {
+                fillRect(rect, { 0, greenValue, 0, 255 });
             }
-            else if (y1 == y2) {
-                SDL_Rect connector = { std::min(x1, x2), y1, static_cast<int>(abs(x1 - x2)) + 12, 12 };
-                SDL_RenderFillRect(renderer, &connector);
+            else {
+                batch.push_back(rect);
             }
         }
+        if (!batch.empty()) {
+            fillRects(batch.data(), static_cast<int>(batch.size()), { 0, 200, 0, 255 });
+        }
     }
 
-    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-    SDL_Rect foodRect = { foodPosition.x, foodPosition.y, 10, 10 };
-    SDL_RenderFillRect(renderer, &foodRect);
-
-    SDL_Color textColor = { 255, 255, 255, 255 };
-    std::string scoreText = "Score: " + std::to_string(score);
-    SDL_Surface* scoreSurface = TTF_RenderText_Solid(font, scoreText.c_str(), textColor);
-    if (scoreSurface) {
-        SDL_Texture* scoreTexture = SDL_CreateTextureFromSurface(renderer, scoreSurface);
-        if (scoreTexture) {
-            SDL_Rect scoreRect = { 10, 10, scoreSurface->w, scoreSurface->h };
-            SDL_RenderCopy(renderer, scoreTexture, nullptr, &scoreRect);
-            SDL_DestroyTexture(scoreTexture);
+    if (!snakeBody.empty()) {
+        SDL_Point head = snakeBody.head();
+        SDL_Rect headRect = { head.x - 2, head.y - 2, 16, 16 };
+        if (cullAndOffset(headRect)) {
+            fillRect(headRect, { 0, 255, 0, 255 });
         }
-        SDL_FreeSurface(scoreSurface);
     }
 
-    std::string timerText = "Time: " + (currentMode == MODE_2 ? "inf" : std::to_string(timer));
-    SDL_Surface* timerSurface = TTF_RenderText_Solid(font, timerText.c_str(), textColor);
-    if (timerSurface) {
-        SDL_Texture* timerTexture = SDL_CreateTextureFromSurface(renderer, timerSurface);
-        if (timerTexture) {
-            SDL_Rect timerRect = { windowWidth - 150, 10, timerSurface->w, timerSurface->h };
-            SDL_RenderCopy(renderer, timerTexture, nullptr, &timerRect);
-            SDL_DestroyTexture(timerTexture);
+    const SDL_Color foodColor = { 255, 0, 0, 255 };
+    if (worldMode) {
+        world.forEachFoodInView(camera, [this, foodColor](int x, int y) {
+            SDL_Rect foodRect = { x - camera.x, y - camera.y, 10, 10 };
+            fillRect(foodRect, foodColor);
+            });
+    }
+    else {
+        SDL_Rect foodRect = { foodPosition.x, foodPosition.y, 10, 10 };
+        if (cullAndOffset(foodRect)) {
+            fillRect(foodRect, foodColor);
         }
-        SDL_FreeSurface(timerSurface);
     }
 
-    if (snakeSpeed == snakeBoostedSpeed) {
-        std::string boostText = "Boost Mode";
-        SDL_Surface* boostSurface = TTF_RenderText_Solid(font, boostText.c_str(), textColor);
-        if (boostSurface) {
-            SDL_Texture* boostTexture = SDL_CreateTextureFromSurface(renderer, boostSurface);
-            if (boostTexture) {
-                SDL_Rect boostRect = { windowWidth - 150, 50, boostSurface->w, boostSurface->h };
-                SDL_RenderCopy(renderer, boostTexture, nullptr, &boostRect);
-                SDL_DestroyTexture(boostTexture);
-            }
-            SDL_FreeSurface(boostSurface);
-        }
+    // Lower quality levels refresh the HUD values less often, so their text is
+    // re-rasterized less often too.
+    if (frameIndex - hudRefreshFrame >= static_cast<Uint32>(quality.textRefreshFrames)) {
+        hudScore = score;
+        hudTimer = timer;
+        hudRefreshFrame = frameIndex;
     }
 
-    if (askingForName) {
-        std::string prompt = "Enter your name:";
-        SDL_Surface* promptSurface = TTF_RenderText_Solid(font, prompt.c_str(), textColor);
-        if (promptSurface) {
-            SDL_Texture* promptTexture = SDL_CreateTextureFromSurface(renderer, promptSurface);
-            if (promptTexture) {
-                SDL_Rect promptRect = { windowWidth / 2 - 100, windowHeight / 2 + 25, promptSurface->w, promptSurface->h };
-                SDL_RenderCopy(renderer, promptTexture, nullptr, &promptRect);
-                SDL_DestroyTexture(promptTexture);
-            }
-            SDL_FreeSurface(promptSurface);
-        }
+    SDL_Color textColor = { 255, 255, 255, 255 };
+    FixedText<32> scoreText;
+    scoreText.append("Score: ").append(hudScore);
+    drawText(scoreText.c_str(), 10, 10, textColor, font);
 
-        SDL_Surface* nameSurface = TTF_RenderText_Solid(font, inputText.c_str(), textColor);
-        if (nameSurface) {
-            SDL_Texture* nameTexture = SDL_CreateTextureFromSurface(renderer, nameSurface);
-            if (nameTexture) {
-                SDL_Rect nameRect = { windowWidth / 2 - 100, windowHeight / 2 + 50, nameSurface->w, nameSurface->h };
-                SDL_RenderCopy(renderer, nameTexture, nullptr, &nameRect);
-                SDL_DestroyTexture(nameTexture);
-            }
-            SDL_FreeSurface(nameSurface);
-        }
+    FixedText<32> timerText;
+    timerText.append("Time: ");
+    if (currentMode == MODE_2) timerText.append("inf");
+    else timerText.append(hudTimer);
+    drawText(timerText.c_str(), windowWidth - 150, 10, textColor, font);
+
+    if (snakeSpeed == snakeBoostedSpeed) {
+        drawText("Boost Mode", windowWidth - 150, 50, textColor, font);
     }
 
     if (isPaused) {
         SDL_Color pauseColor = { 255, 255, 0, 255 };
-        SDL_Surface* pauseSurface = TTF_RenderText_Solid(font, "Paused", pauseColor);
-        if (pauseSurface) {
-            SDL_Texture* pauseTexture = SDL_CreateTextureFromSurface(renderer, pauseSurface);
-            if (pauseTexture) {
-                SDL_Rect pauseRect = { windowWidth / 2 - 50, windowHeight / 2 - 50, pauseSurface->w, pauseSurface->h };
-                SDL_RenderCopy(renderer, pauseTexture, nullptr, &pauseRect);
-                SDL_DestroyTexture(pauseTexture);
-            }
-            SDL_FreeSurface(pauseSurface);
-        }
+        drawText("Paused", windowWidth / 2 - 50, windowHeight / 2 - 50, pauseColor, font);
     }
 }
 
@@ -637,201 +827,186 @@ void Engine::resetSnakeGame() {
     snakeGameActive = false;
     gameOver = false;
     isPaused = false;
-    askingForName = false;
-    showingScoreboard = false;
     showConfetti = false;
     confettiParticles.clear();
     snakeBody.clear();
+    clearRewindHistory();
     currentMode = MODE_NONE;
+    timers.cancel(snakeStepTimer);
+    timers.cancel(countdownTimer);
+    timers.cancel(confettiTimer);
+    tasks.cancel(gameOverTask);
+    if (worldMode) {
+        world.close();
+        worldMode = false;
+    }
+    updateCamera();
+    scenes.popTo(&sandboxScene);
 }
 
 void Engine::drawTextBox() {
+    PROFILE_ZONE("drawTextBox");
     SDL_Rect textBoxRect = { windowWidth / 2 - 400, windowHeight / 2 - 150, 800, 300 };
-    SDL_SetRenderDrawColor(renderer, 100, 100, 100, 255);
-    SDL_RenderFillRect(renderer, &textBoxRect);
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderDrawRect(renderer, &textBoxRect);
-
-    if (showHelp) {
-        std::vector<std::string> helpText = {
-            "Shortcut Keys:", "C: Open/Close Chat Box", "X: Return to Main Menu", "E: Toggle Earth Gravity",
-            "M: Toggle Moon Gravity", "R: Change Rectangle Color to Red", "G: Change Rectangle Color to Green",
-            "B: Change Rectangle Color to Blue", "S: Pause/Resume Game", "Arrow Keys: Move Snake",
-            "Backspace: Delete Last Character in Chat", "Type 'play mode1' for Mode 1 (120s, 20 food)",
-            "Type 'play mode2' for Mode 2 (unlimited)", "Type 'play mode3 time x food y' for Mode 3",
-            "Leaderboard:", "Mode 1 (Fastest Time, Most Food):"
-        };
+    fillRect(textBoxRect, { 100, 100, 100, 255 });
+    const SDL_Rect border[4] = {
+        { textBoxRect.x, textBoxRect.y, textBoxRect.w, 1 },
+        { textBoxRect.x, textBoxRect.y + textBoxRect.h - 1, textBoxRect.w, 1 },
+        { textBoxRect.x, textBoxRect.y, 1, textBoxRect.h },
+        { textBoxRect.x + textBoxRect.w - 1, textBoxRect.y, 1, textBoxRect.h },
+    };
+    fillRects(border, 4, { 0, 0, 0, 255 });
+}
 
-        for (size_t i = 0; i < std::min(mode1Scores.size(), static_cast<size_t>(5)); i++) {
-            helpText.push_back(std::to_string(i + 1) + " | " + mode1Scores[i].playerName + " | " + std::to_string(mode1Scores[i].food) + " | " + std::to_string(mode1Scores[i].time) + "s");
-        }
-        helpText.push_back("Mode 2 (Most Food):");
-        for (size_t i = 0; i < std::min(mode2Scores.size(), static_cast<size_t>(5)); i++) {
-            helpText.push_back(std::to_string(i + 1) + " | " + mode2Scores[i].playerName + " | " + std::to_string(mode2Scores[i].food) + " | --");
+void Engine::drawInputText() {
+    const size_t maxCharsPerLine = 96;
+    int lineHeight = 20;
+    SDL_Color textColor = { 255, 255, 255, 255 };
+
+    for (size_t i = 0; i < inputText.length(); i += maxCharsPerLine) {
+        FixedText<maxCharsPerLine + 1> line;
+        line.append(inputText.data() + i, std::min(maxCharsPerLine, inputText.length() - i));
+        drawText(line.c_str(), windowWidth / 2 - 390, windowHeight / 2 - 30 + static_cast<int>(i / maxCharsPerLine) * lineHeight, textColor, font);
+    }
+}
+
+void Engine::drawText(const char* text, int x, int y, SDL_Color color, TTF_Font* textFont, bool centered, const SDL_Rect* clip) {
+    if (!text || text[0] == '\0' || !textFont) return;
+
+    TextCacheEntry* oldest = nullptr;
+    TextCacheEntry* hit = findCachedText(text, color, textFont, oldest);
+    if (!hit) {
+        if (!oldest) return;
+        PROFILE_ZONE("drawText (cache miss)");
+        SDL_Surface* surface = TTF_RenderText_Solid(textFont, text, color);
+        if (!surface) return;
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+        int width = surface->w;
+        int height = surface->h;
+        SDL_FreeSurface(surface);
+        if (!texture) return;
+
+        // The rasterizer draws text at the end of the frame, so a texture
+        // already queued this frame must outlive it: draw this one uncached.
+        if (raster.isOpen() && oldest->texture && oldest->lastUsedFrame == frameIndex) {
+            SDL_Rect textRect = { centered ? x - width / 2 : x, y, width, height };
+            copyText(texture, textRect, clip, true);
+            return;
         }
+        hit = oldest;
+        storeCachedText(hit, text, color, textFont, texture, width, height);
+    }
 
-        SDL_Color textColor = { 255, 255, 255, 255 };
-        int lineHeight = 20;
-        int startY = windowHeight / 2 - 130;
-
-        for (size_t i = 0; i < helpText.size(); i++) {
-            SDL_Surface* textSurface = TTF_RenderText_Solid(font, helpText[i].c_str(), textColor);
-            if (textSurface) {
-                SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-                if (textTexture) {
-                    SDL_Rect textRect = { windowWidth / 2 - 390, startY + static_cast<int>(i) * lineHeight, textSurface->w, textSurface->h };
-                    SDL_RenderCopy(renderer, textTexture, nullptr, &textRect);
-                    SDL_DestroyTexture(textTexture);
-                }
-                SDL_FreeSurface(textSurface);
-            }
+    hit->lastUsedFrame = frameIndex;
+    SDL_Rect textRect = { centered ? x - hit->width / 2 : x, y, hit->width, hit->height };
+    copyText(hit->texture, textRect, clip, false);
+}
+
+// Draws the part of a text texture inside clip (all of it without one).
+void Engine::copyText(SDL_Texture* texture, const SDL_Rect& textRect, const SDL_Rect* clip, bool destroyAfter) {
+    SDL_Rect destination = textRect;
+    SDL_Rect source = { 0, 0, textRect.w, textRect.h };
+    if (clip) {
+        if (!SDL_IntersectRect(&textRect, clip, &destination)) {
+            if (destroyAfter) SDL_DestroyTexture(texture);
+            return;
         }
+        source = { destination.x - textRect.x, destination.y - textRect.y, destination.w, destination.h };
+    }
+    if (raster.isOpen()) {
+        raster.copyTexture(texture, destination, destroyAfter, &source);
     }
     else {
-        std::string displayText = inputText;
-        int maxCharsPerLine = 96;
-        int lineHeight = 20;
-
-        for (size_t i = 0; i < displayText.length(); i += maxCharsPerLine) {
-            std::string line = displayText.substr(i, maxCharsPerLine);
-            SDL_Color textColor = { 255, 255, 255, 255 };
-            SDL_Surface* textSurface = TTF_RenderText_Solid(font, line.c_str(), textColor);
-            if (textSurface) {
-                SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-                if (textTexture) {
-                    SDL_Rect textRect = { windowWidth / 2 - 390, windowHeight / 2 - 30 + static_cast<int>(i / maxCharsPerLine) * lineHeight, textSurface->w, textSurface->h };
-                    SDL_RenderCopy(renderer, textTexture, nullptr, &textRect);
-                    SDL_DestroyTexture(textTexture);
-                }
-                SDL_FreeSurface(textSurface);
-            }
+        SDL_RenderCopy(renderer, texture, &source, &destination);
+        if (destroyAfter) SDL_DestroyTexture(texture);
+    }
+}
+
+TextCacheEntry* Engine::findCachedText(const char* text, SDL_Color color, TTF_Font* textFont, TextCacheEntry*& oldest) {
+    oldest = nullptr;
+    for (auto& entry : textCache) {
+        if (entry.texture && entry.font == textFont &&
+            entry.color.r == color.r && entry.color.g == color.g && entry.color.b == color.b && entry.color.a == color.a &&
+            entry.text == text) {
+            return &entry;
+        }
+        if (!oldest || !entry.texture || (oldest->texture && entry.lastUsedFrame < oldest->lastUsedFrame)) {
+            oldest = &entry;
         }
     }
+    return nullptr;
 }
 
-void Engine::renderScoreboard() {
-    SDL_Color textColor = { 255, 255, 255, 255 };
-    TTF_Font* boldFont = TTF_OpenFont("fonts/arial.ttf", 24);
-    if (!boldFont) boldFont = font;
-    TTF_SetFontStyle(boldFont, TTF_STYLE_BOLD);
+void Engine::storeCachedText(TextCacheEntry* entry, const char* text, SDL_Color color, TTF_Font* textFont, SDL_Texture* texture, int width, int height) {
+    if (entry->texture) SDL_DestroyTexture(entry->texture);
+    entry->text.assign(text);
+    entry->font = textFont;
+    entry->color = color;
+    entry->texture = texture;
+    entry->width = width;
+    entry->height = height;
+}
 
-    std::vector<std::string> leaderboard;
-    leaderboard.push_back(" | Rank | Player         | Food | Time  |");
-    leaderboard.push_back("-----------------------------------------");
+// Runs on the scene loader thread, with the loader's own font handles.
+SDL_Surface* Engine::bakeText(const char* text, SDL_Color color, TTF_Font* textFont) const {
+    TTF_Font* bakeFont = textFont == boldFont ? loaderBoldFont : loaderFont;
+    if (!text || text[0] == '\0' || !bakeFont) return nullptr;
+    return TTF_RenderText_Solid(bakeFont, text, color);
+}
 
-    if (currentMode == MODE_1) {
-        int timeTaken = 120 - timer;
-        bool found = false;
-        for (size_t i = 0; i < std::min(mode1Scores.size(), static_cast<size_t>(5)); ++i) {
-            std::string entry = " | " + std::string(5 - std::to_string(i + 1).length(), ' ') + std::to_string(i + 1) + " | " +
-                mode1Scores[i].playerName + std::string(15 - mode1Scores[i].playerName.length(), ' ') + " | " +
-                std::to_string(mode1Scores[i].food) + std::string(5 - std::to_string(mode1Scores[i].food).length(), ' ') + " | " +
-                std::to_string(mode1Scores[i].time) + "s" + std::string(6 - std::to_string(mode1Scores[i].time).length(), ' ');
-
-            if (mode1Scores[i].food == 20 && mode1Scores[i].playerName == inputText && mode1Scores[i].time == timeTaken) {
-                entry += " (You)";
-                found = true;
-                SDL_Surface* boldSurface = TTF_RenderText_Solid(boldFont, entry.c_str(), textColor);
-                if (boldSurface) {
-                    SDL_Texture* boldTexture = SDL_CreateTextureFromSurface(renderer, boldSurface);
-                    SDL_Rect textRect = { windowWidth / 2 - boldSurface->w / 2, windowHeight / 2 + static_cast<int>(i + 2) * 20, boldSurface->w, boldSurface->h };
-                    SDL_RenderCopy(renderer, boldTexture, nullptr, &textRect);
-                    SDL_DestroyTexture(boldTexture);
-                    SDL_FreeSurface(boldSurface);
-                }
-            }
-            else {
-                SDL_Surface* surface = TTF_RenderText_Solid(font, entry.c_str(), textColor);
-                if (surface) {
-                    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-                    SDL_Rect textRect = { windowWidth / 2 - surface->w / 2, windowHeight / 2 + static_cast<int>(i + 2) * 20, surface->w, surface->h };
-                    SDL_RenderCopy(renderer, texture, nullptr, &textRect);
-                    SDL_DestroyTexture(texture);
-                    SDL_FreeSurface(surface);
-                }
-            }
-        }
-        if (!found) {
-            std::string yourEntry = " | " + std::string(5 - std::to_string(mode1Scores.size() + 1).length(), ' ') + std::to_string(mode1Scores.size() + 1) + " | " +
-                inputText + std::string(15 - inputText.length(), ' ') + " | " +
-                std::to_string(score) + std::string(5 - std::to_string(score).length(), ' ') + " | " +
-                std::to_string(120 - timer) + "s" + std::string(6 - std::to_string(120 - timer).length(), ' ') + " (You)";
-            SDL_Surface* boldSurface = TTF_RenderText_Solid(boldFont, yourEntry.c_str(), textColor);
-            if (boldSurface) {
-                SDL_Texture* boldTexture = SDL_CreateTextureFromSurface(renderer, boldSurface);
-                SDL_Rect textRect = { windowWidth / 2 - boldSurface->w / 2, windowHeight / 2 + static_cast<int>(mode1Scores.size() + 2) * 20, boldSurface->w, boldSurface->h };
-                SDL_RenderCopy(renderer, boldTexture, nullptr, &textRect);
-                SDL_DestroyTexture(boldTexture);
-                SDL_FreeSurface(boldSurface);
-            }
+// Moves text baked by the loader into the cache, so drawing it later is a hit.
+void Engine::adoptText(BakedText& baked) {
+    if (!baked.surface) return;
+
+    TextCacheEntry* oldest = nullptr;
+    TextCacheEntry* hit = findCachedText(baked.text.c_str(), baked.color, baked.font, oldest);
+    if (!hit && oldest && !(raster.isOpen() && oldest->texture && oldest->lastUsedFrame == frameIndex)) {
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, baked.surface);
+        if (texture) {
+            hit = oldest;
+            storeCachedText(hit, baked.text.c_str(), baked.color, baked.font, texture, baked.surface->w, baked.surface->h);
         }
     }
-    else if (currentMode == MODE_2) {
-        bool found = false;
-        for (size_t i = 0; i < std::min(mode2Scores.size(), static_cast<size_t>(5)); ++i) {
-            std::string entry = " | " + std::string(5 - std::to_string(i + 1).length(), ' ') + std::to_string(i + 1) + " | " +
-                mode2Scores[i].playerName + std::string(15 - mode2Scores[i].playerName.length(), ' ') + " | " +
-                std::to_string(mode2Scores[i].food) + std::string(5 - std::to_string(mode2Scores[i].food).length(), ' ') + " | --";
-
-            if (mode2Scores[i].playerName == inputText && mode2Scores[i].food == score) {
-                entry += " (You)";
-                found = true;
-                SDL_Surface* boldSurface = TTF_RenderText_Solid(boldFont, entry.c_str(), textColor);
-                if (boldSurface) {
-                    SDL_Texture* boldTexture = SDL_CreateTextureFromSurface(renderer, boldSurface);
-                    SDL_Rect textRect = { windowWidth / 2 - boldSurface->w / 2, windowHeight / 2 + static_cast<int>(i + 2) * 20, boldSurface->w, boldSurface->h };
-                    SDL_RenderCopy(renderer, boldTexture, nullptr, &textRect);
-                    SDL_DestroyTexture(boldTexture);
-                    SDL_FreeSurface(boldSurface);
-                }
-            }
-            else {
-                SDL_Surface* surface = TTF_RenderText_Solid(font, entry.c_str(), textColor);
-                if (surface) {
-                    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-                    SDL_Rect textRect = { windowWidth / 2 - surface->w / 2, windowHeight / 2 + static_cast<int>(i + 2) * 20, surface->w, surface->h };
-                    SDL_RenderCopy(renderer, texture, nullptr, &textRect);
-                    SDL_DestroyTexture(texture);
-                    SDL_FreeSurface(surface);
-                }
-            }
-        }
-        if (!found) {
-            std::string yourEntry = " | " + std::string(5 - std::to_string(mode2Scores.size() + 1).length(), ' ') + std::to_string(mode2Scores.size() + 1) + " | " +
-                inputText + std::string(15 - inputText.length(), ' ') + " | " +
-                std::to_string(score) + std::string(5 - std::to_string(score).length(), ' ') + " | -- (You)";
-            SDL_Surface* boldSurface = TTF_RenderText_Solid(boldFont, yourEntry.c_str(), textColor);
-            if (boldSurface) {
-                SDL_Texture* boldTexture = SDL_CreateTextureFromSurface(renderer, boldSurface);
-                SDL_Rect textRect = { windowWidth / 2 - boldSurface->w / 2, windowHeight / 2 + static_cast<int>(mode2Scores.size() + 2) * 20, boldSurface->w, boldSurface->h };
-                SDL_RenderCopy(renderer, boldTexture, nullptr, &textRect);
-                SDL_DestroyTexture(boldTexture);
-                SDL_FreeSurface(boldSurface);
-            }
-        }
+    if (hit) hit->lastUsedFrame = frameIndex;
+    SDL_FreeSurface(baked.surface);
+    baked.surface = nullptr;
+}
+
+void Engine::fillRect(const SDL_Rect& rect, SDL_Color color) {
+    if (raster.isOpen()) {
+        raster.fillRect(rect, color);
+        return;
     }
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRect(renderer, &rect);
+}
 
-    std::string returnText = "Press Enter or X to return";
-    SDL_Surface* returnSurface = TTF_RenderText_Solid(font, returnText.c_str(), textColor);
-    if (returnSurface) {
-        SDL_Texture* returnTexture = SDL_CreateTextureFromSurface(renderer, returnSurface);
-        SDL_Rect returnRect = { windowWidth / 2 - returnSurface->w / 2, windowHeight / 2 + static_cast<int>(std::max(mode1Scores.size(), mode2Scores.size()) + 3) * 20, returnSurface->w, returnSurface->h };
-        SDL_RenderCopy(renderer, returnTexture, nullptr, &returnRect);
-        SDL_DestroyTexture(returnTexture);
-        SDL_FreeSurface(returnSurface);
+void Engine::fillRects(const SDL_Rect* rects, int count, SDL_Color color) {
+    if (raster.isOpen()) {
+        raster.fillRects(rects, count, color);
+        return;
     }
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRects(renderer, rects, count);
+}
 
-    if (boldFont != font) TTF_CloseFont(boldFont);
+void Engine::clearTextCache() {
+    for (auto& entry : textCache) {
+        if (entry.texture) SDL_DestroyTexture(entry.texture);
+        entry.texture = nullptr;
+        entry.font = nullptr;
+    }
 }
 
 void Engine::updateConfetti() {
     if (!showConfetti) return;
 
-    Uint32 currentTime = SDL_GetTicks();
-    if (currentTime - confettiStartTime > 2000) {
-        showConfetti = false;
-        confettiParticles.clear();
-        return;
+    if (pendingConfetti > 0) {
+        emitConfetti();
+    }
+    // A lower level also trims particles that are already flying.
+    size_t maxParticles = static_cast<size_t>(governor.settings().maxConfetti);
+    if (confettiParticles.size() > maxParticles) {
+        confettiParticles.resize(maxParticles);
     }
 
     for (auto& particle : confettiParticles) {
@@ -847,14 +1022,14 @@ void Engine::updateConfetti() {
 
 void Engine::renderConfetti() {
     for (const auto& particle : confettiParticles) {
-        SDL_SetRenderDrawColor(renderer, particle.color.r, particle.color.g, particle.color.b, particle.color.a);
+        if (particle.x + 5 < 0 || particle.y + 5 < 0 || particle.x >= windowWidth || particle.y >= windowHeight) continue;
         SDL_Rect rect = {
             static_cast<int>(particle.x),
             static_cast<int>(particle.y),
             5,
             5
         };
-        SDL_RenderFillRect(renderer, &rect);
+        fillRect(rect, particle.color);
     }
 }
 
@@ -867,115 +1042,75 @@ void Engine::setBackgroundColor(const std::string& colorName) {
 }
 
 void Engine::update() {
+    PROFILE_ZONE("update");
     Uint32 currentTime = SDL_GetTicks();
     deltaTime = (currentTime - lastUpdateTime) / 1000.0f;
     lastUpdateTime = currentTime;
 
-    if (snakeGameActive && !showingScoreboard) {
-        updateSnakeGame();
-    }
-    else if (gravityMode) {
-        velocityY += gravityAcceleration * deltaTime * 60.0f;
-        rectY += static_cast<int>(velocityY * deltaTime * 60.0f);
+    // Runs whatever came due since the last frame: snake steps, the
+    // countdown, confetti expiry and the FPS window.
+    timers.advance(currentTime);
+    tasks.runFrame();
 
-        if (rectY + rectHeight >= windowHeight) {
-            rectY = windowHeight - rectHeight;
-            velocityY = -velocityY * bounceFactor;
-            if (std::abs(velocityY) < 1.0f) {
-                velocityY = 0;
-                isOnGround = true;
-            }
-        }
-
-        if (isOnGround) {
-            velocityY *= (1.0f - groundFriction * deltaTime * 60.0f);
-        }
-        else {
-            isOnGround = false;
-        }
-    }
+    scenes.poll();
+    scenes.update(deltaTime);
 
     if (showConfetti) {
         updateConfetti();
     }
 
     frameCount++;
-    if (currentTime - lastFPSUpdateTime >= 1000) {
-        fps = frameCount;
-        frameCount = 0;
-        lastFPSUpdateTime = currentTime;
-    }
 }
 
 void Engine::render() {
-    SDL_SetRenderDrawColor(renderer, backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a);
-    SDL_RenderClear(renderer);
-
-    if (showingScoreboard) {
-        renderScoreboard();
-    }
-    else if (snakeGameActive) {
-        renderSnakeGame();
+    PROFILE_ZONE("render");
+    if (raster.isOpen()) {
+        raster.beginFrame(windowWidth, windowHeight, backgroundColor);
     }
     else {
-        SDL_Rect rect = { rectX, rectY, rectWidth, rectHeight };
-        SDL_SetRenderDrawColor(renderer, rectColor.r, rectColor.g, rectColor.b, rectColor.a);
-        SDL_RenderFillRect(renderer, &rect);
-
-        SDL_Color textColor = gravityMode ? SDL_Color{ 255, 0, 0, 255 } : SDL_Color{ 255, 255, 255, 255 };
-        SDL_Surface* textSurface = TTF_RenderText_Solid(font, gravityText.c_str(), textColor);
-        if (textSurface) {
-            SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-            SDL_Rect textRect = { windowWidth - 200, 10, textSurface->w, textSurface->h };
-            SDL_RenderCopy(renderer, textTexture, nullptr, &textRect);
-            SDL_DestroyTexture(textTexture);
-            SDL_FreeSurface(textSurface);
-        }
+        SDL_SetRenderDrawColor(renderer, backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a);
+        SDL_RenderClear(renderer);
     }
 
-    if (showTextBox) {
-        drawTextBox();
-    }
+    scenes.render();
 
     if (showConfetti) {
         renderConfetti();
     }
 
+    if (raster.isOpen()) {
+        PROFILE_ZONE("rasterize");
+        raster.endFrame();
+    }
+    if (capture.wantsFrame()) {
+        PROFILE_ZONE("capture");
+        capture.captureFrame(renderer, frameIndex);
+    }
     SDL_RenderPresent(renderer);
+    latency.onPresent();
 }
 
 void Engine::saveScore() {
+    PROFILE_ZONE("saveScore");
+    // Remember where the entry went: the scoreboard opens on that row.
     if (currentMode == MODE_1) {
-        int timeTaken = 120 - timer;
-        mode1Scores.push_back({ inputText, score, timeTaken });
-        std::sort(mode1Scores.begin(), mode1Scores.end(), [](const ScoreEntry& a, const ScoreEntry& b) {
-            return (a.food == 20 && b.food == 20) ? (a.time < b.time) : (a.food > b.food);
-            });
+        ScoreEntry entry = { inputText, score, 120 - timer };
+        savedScoreRow = mode1Scores.insert(entry);
+        scoreWriter.append(MODE_1, entry);
     }
     else if (currentMode == MODE_2) {
-        mode2Scores.push_back({ inputText, score, 0 });
-        std::sort(mode2Scores.begin(), mode2Scores.end(), [](const ScoreEntry& a, const ScoreEntry& b) {
-            return a.food > b.food;
-            });
-    }
-
-    std::ofstream file("scores.txt");
-    if (file.is_open()) {
-        file << "Mode 1 Scores:\n";
-        for (const auto& entry : mode1Scores) {
-            file << entry.playerName << " " << entry.food << " " << entry.time << "\n";
-        }
-        file << "Mode 2 Scores:\n";
-        for (const auto& entry : mode2Scores) {
-            file << entry.playerName << " " << entry.food << "\n";
-        }
-        file.close();
+        ScoreEntry entry = { inputText, score, 0 };
+        savedScoreRow = mode2Scores.insert(entry);
+        scoreWriter.append(MODE_2, entry);
     }
 }
 
 void Engine::loadScores() {
+    PROFILE_ZONE("loadScores");
     std::ifstream file("scores.txt");
     if (file.is_open()) {
+        std::vector<ScoreEntry> mode1Entries;
+        std::vector<ScoreEntry> mode2Entries;
         std::string line;
         bool mode1Section = false;
         while (std::getline(file, line)) {
@@ -993,87 +1128,190 @@ void Engine::loadScores() {
             int food, time = 0;
             if (mode1Section) {
                 if (iss >> name >> food >> time) {
-                    mode1Scores.push_back({ name, food, time });
+                    mode1Entries.push_back({ name, food, time });
                 }
             }
             else {
                 if (iss >> name >> food) {
-                    mode2Scores.push_back({ name, food, 0 });
+                    mode2Entries.push_back({ name, food, 0 });
                 }
             }
         }
         file.close();
 
-        std::sort(mode1Scores.begin(), mode1Scores.end(), [](const ScoreEntry& a, const ScoreEntry& b) {
-            return (a.food == 20 && b.food == 20) ? (a.time < b.time) : (a.food > b.food);
-            });
-
-        std::sort(mode2Scores.begin(), mode2Scores.end(), [](const ScoreEntry& a, const ScoreEntry& b) {
-            return a.food > b.food;
-            });
+        // Sorted stably, so equal scores keep the order they were saved in,
+        // the same order saveScore() inserts them.
+        mode1Scores.assign(mode1Entries);
+        mode2Scores.assign(mode2Entries);
     }
 }
 
 void Engine::showScoreboard() {
-    std::cout << "Mode 1 Leaderboard (Fastest Time, Most Food):\n";
+    std::ostringstream board;
+    board << "Mode 1 Leaderboard (Fastest Time, Most Food):\n";
     for (size_t i = 0; i < std::min(mode1Scores.size(), static_cast<size_t>(5)); i++) {
-        std::cout << i + 1 << " | " << mode1Scores[i].playerName << " | " << mode1Scores[i].food << " | " << mode1Scores[i].time << "s\n";
+        board << i + 1 << " | " << mode1Scores[i].playerName << " | " << mode1Scores[i].food << " | " << mode1Scores[i].time << "s\n";
     }
-    std::cout << "Mode 2 Leaderboard (Most Food):\n";
+    board << "Mode 2 Leaderboard (Most Food):\n";
     for (size_t i = 0; i < std::min(mode2Scores.size(), static_cast<size_t>(5)); i++) {
-        std::cout << i + 1 << " | " << mode2Scores[i].playerName << " | " << mode2Scores[i].food << " | --\n";
+        board << i + 1 << " | " << mode2Scores[i].playerName << " | " << mode2Scores[i].food << " | --\n";
     }
+    LOG_INFO("{}", board.str());
 }
 
-void Engine::moveSnake() {
-    if (!snakeGameActive || gameOver || isPaused) return;
+void Engine::spawnFood() {
+    foodPosition.x = rand() % (windowWidth - 10);
+    foodPosition.y = rand() % (windowHeight - 10);
+}
 
-    Uint32 currentTime = SDL_GetTicks();
-    Uint32 moveInterval = (snakeSpeed == snakeBoostedSpeed) ? 20 : 40;
-    if (currentTime - lastSnakeMoveTime < moveInterval) return;
-    lastSnakeMoveTime = currentTime;
+void Engine::captureSnapshot(Snapshot& snapshot) const {
+    Uint32 now = SDL_GetTicks();
+    SnapshotHeader& header = snapshot.header;
+    header = {};
+
+    header.snakeGameActive = snakeGameActive;
+    header.gameOver = gameOver;
+    header.isPaused = isPaused;
+    header.currentMode = currentMode;
+    header.snakeDirection = snakeDirection;
+    header.snakeSpeed = snakeSpeed;
+    header.score = score;
+    header.timer = timer;
+    header.foodGoal = foodGoal;
+    header.foodX = foodPosition.x;
+    header.foodY = foodPosition.y;
+    header.msUntilCountdownTick = static_cast<Uint32>(timers.remaining(countdownTimer));
+    header.msSinceSnakeMove = now - lastSnakeMoveTime;
+
+    header.showConfetti = showConfetti;
+    header.msUntilConfettiEnd = static_cast<Uint32>(timers.remaining(confettiTimer));
+
+    header.gravityMode = gravityMode;
+    header.rectX = rectX;
+    header.rectY = rectY;
+    header.velocityY = velocityY;
+    header.gravitySpeed = gravitySpeed;
+    header.gravityAcceleration = gravityAcceleration;
+    header.isOnGround = isOnGround;
+    header.worldMode = worldMode;
+
+    header.snakeFirstRun = snakeBody.firstRunIndex();
+    snakeBody.copyRuns(snapshot.snake);
+    snapshot.particles.assign(confettiParticles.begin(), confettiParticles.end());
+}
 
-    int newX = snakeBody[0].x;
-    int newY = snakeBody[0].y;
+void Engine::restoreSnapshot(const Snapshot& snapshot) {
+    Uint32 now = SDL_GetTicks();
+    const SnapshotHeader& header = snapshot.header;
+
+    snakeGameActive = header.snakeGameActive != 0;
+    gameOver = header.gameOver != 0;
+    isPaused = header.isPaused != 0;
+    currentMode = static_cast<GameMode>(header.currentMode);
+    snakeDirection = static_cast<Direction>(header.snakeDirection);
+    snakeSpeed = header.snakeSpeed;
+    score = header.score;
+    timer = header.timer;
+    foodGoal = header.foodGoal;
+    foodPosition = { header.foodX, header.foodY };
+    lastSnakeMoveTime = now - header.msSinceSnakeMove;
+
+    showConfetti = header.showConfetti != 0;
+    if (showConfetti) startConfettiTimer(header.msUntilConfettiEnd);
+    else timers.cancel(confettiTimer);
+
+    gravityMode = header.gravityMode != 0;
+    rectX = header.rectX;
+    rectY = header.rectY;
+    velocityY = header.velocityY;
+    gravitySpeed = header.gravitySpeed;
+    gravityAcceleration = header.gravityAcceleration;
+    isOnGround = header.isOnGround != 0;
+
+    snakeBody.assign(snapshot.snake.data(), snapshot.snake.size(), header.snakeFirstRun);
+    confettiParticles.assign(snapshot.particles.begin(), snapshot.particles.end());
+    scheduleSnakeStep();
+    scheduleCountdown(header.msUntilCountdownTick);
+    if (!gameOver && tasks.cancel(gameOverTask)) {
+        scenes.popTo(&snakeScene);
+    }
+    if (snakeGameActive != scenes.contains(&snakeScene)) {
+        // A quick-load can cross between the sandbox and a game.
+        scenes.popTo(&sandboxScene);
+        if (snakeGameActive) scenes.push(&snakeScene);
+    }
+    updateCamera();
+}
 
-    int stepSize = 4;
-    switch (snakeDirection) {
-    case UP: newY -= stepSize; break;
-    case DOWN: newY += stepSize; break;
-    case LEFT: newX -= stepSize; break;
-    case RIGHT: newX += stepSize; break;
+void Engine::recordRewindFrame() {
+    if (!snakeGameActive || gameOver || isPaused) return;
+
+    captureSnapshot(workSnapshot);
+    if (hasLiveSnapshot) {
+        // Store how to get from the new frame back to the previous one.
+        encodeSnapshot(liveSnapshot, &workSnapshot, snapshotScratch, snapshotRecord);
+        rewindBuffer.push(snapshotRecord);
     }
+    std::swap(liveSnapshot, workSnapshot);
+    hasLiveSnapshot = true;
+}
 
-    snakeBody.insert(snakeBody.begin(), { newX, newY });
+// Spectators get every frame of a running game, including paused and
+// game-over frames that the rewind history skips.
+void Engine::broadcastTick() {
+    if (!spectators.isOpen()) return;
 
-    if (abs(newX - foodPosition.x) < 10 && abs(newY - foodPosition.y) < 10) {
-        spawnFood();
-        score++;
+    if (hasLiveSnapshot && !gameOver && !isPaused) {
+        spectators.publish(liveSnapshot);
+        return;
     }
-    else {
-        snakeBody.pop_back();
+    captureSnapshot(workSnapshot);
+    spectators.publish(workSnapshot);
+}
+
+void Engine::rewindStep() {
+    size_t size = 0;
+    const Uint8* record = rewindBuffer.newest(size);
+    if (!record || !hasLiveSnapshot) return;
+
+    if (decodeSnapshot(record, size, &liveSnapshot, snapshotScratch, workSnapshot)) {
+        restoreSnapshot(workSnapshot);
+        std::swap(liveSnapshot, workSnapshot);
     }
+    rewindBuffer.popNewest();
+}
 
-    checkCollision();
+void Engine::clearRewindHistory() {
+    rewindBuffer.clear();
+    hasLiveSnapshot = false;
+    rewinding = false;
 }
 
-void Engine::spawnFood() {
-    foodPosition.x = rand() % (windowWidth - 10);
-    foodPosition.y = rand() % (windowHeight - 10);
+void Engine::quickSave() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    captureSnapshot(workSnapshot);
+    encodeSnapshot(workSnapshot, nullptr, snapshotScratch, quickSaveData);
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    LOG_INFO("Quick-save: {} bytes in {} ms", quickSaveData.size(), ms);
 }
 
-void Engine::checkCollision() {
-    SDL_Point head = snakeBody[0];
+void Engine::quickLoad() {
+    if (quickSaveData.empty()) return;
 
-    if (head.x < 0 || head.x >= windowWidth || head.y < 0 || head.y >= windowHeight) {
-        gameOver = true;
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (!decodeSnapshot(quickSaveData.data(), quickSaveData.size(), nullptr, snapshotScratch, workSnapshot)) {
+        LOG_ERROR("Quick-load failed: snapshot is corrupt");
         return;
     }
-
-    for (size_t i = 1; i < snakeBody.size(); i++) {
-        if (head.x == snakeBody[i].x && head.y == snakeBody[i].y) {
-            gameOver = true;
-            return;
-        }
+    if ((workSnapshot.header.worldMode != 0) != worldMode) {
+        LOG_WARN("Quick-load skipped: snapshot was taken in a different arena");
+        return;
     }
-}
\ No newline at end of file
+
+    restoreSnapshot(workSnapshot);
+    clearRewindHistory();
+    std::swap(liveSnapshot, workSnapshot);
+    hasLiveSnapshot = true;
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    LOG_INFO("Quick-load: restored {} segments in {} ms", snakeBody.length(), ms);
+}
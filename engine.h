@@ -9,20 +9,61 @@
 #include <sstream>
 #include <random>
 #include <fstream>
+#include "audio.h"
+#include "frame_arena.h"
+#include "frame_capture.h"
+#include "game_types.h"
+#include "latency.h"
+#include "metrics.h"
+#include "quality_governor.h"
+#include "scenes.h"
+#include "score_table.h"
+#include "score_writer.h"
+#include "snake_body.h"
+#include "snapshot.h"
+#include "soft_raster.h"
+#include "spectator_relay.h"
+#include "stall_watchdog.h"
+#include "task_scheduler.h"
+#include "timer_wheel.h"
+#include "world.h"
 
-enum Direction { UP, DOWN, LEFT, RIGHT };
-enum GameMode { MODE_NONE, MODE_1, MODE_2, MODE_3 };
-
-struct ScoreEntry {
-    std::string playerName;
-    int food;
-    int time;
+// Command-line driven settings, applied before initialize().
+struct EngineOptions {
+    bool headless = false;      // dummy video driver and software renderer
+    int frameLimit = 0;         // stop after this many frames; 0 runs until quit
+    Uint64 allocBudget = 0;     // max heap allocations per frame (0 = unlimited)
+    Uint64 allocByteBudget = 0;
+    int allocWarmupFrames = 60;
+    std::string audioDriver;    // SDL audio driver override, e.g. "dummy" or "disk"
+    bool audioLowLatency = false;
+    bool latencyMode = false;   // record event->sim and event->present latency
+    int injectInputMs = 0;      // synthetic steering input every N ms (0 = off)
+    std::string latencyOut;     // CSV file for the latency percentiles
+    double frameBudgetMs = 8.0; // work time per frame the quality governor aims for (0 = off)
+    bool stress = false;        // long snake and constant confetti bursts, to test the governor
+    bool softRaster = false;    // fill quads on the CPU into a streaming texture
+    int rasterThreads = 0;      // rasterizer threads (0 = one per core)
+    int spectatorPort = 0;      // stream snake games to TCP spectators on this port (0 = off)
+    int spectatorBench = 0;     // run the loopback relay test with this many spectators and exit
+    int metricsPort = 0;        // serve Prometheus metrics on localhost:PORT/metrics (0 = off)
+    std::string metricsFile;    // append a metrics snapshot here every 10 s, rotating at 1 MB
+    bool serializerBench = false; // run the bit-packing throughput test and exit
+    std::string logFile;        // also write log messages here, rotating at 4 MB
+    std::string capturePath;    // record every presented frame to this file (F12 takes a screenshot regardless)
+    std::string captureExtract; // write the frames of this recording out as BMP files and exit
+    double stallThresholdMs = 200.0; // report frames slower than this, with main-thread stacks (0 = off)
+    std::string stallReport = "stalls.txt"; // each stall appends a report here
 };
 
-struct Confetti {
-    float x, y;
-    float velocityX, velocityY;
+// Rendered text kept between frames so unchanged labels are not re-rasterized.
+struct TextCacheEntry {
+    std::string text;
+    TTF_Font* font;
     SDL_Color color;
+    SDL_Texture* texture;
+    int width, height;
+    Uint32 lastUsedFrame;
 };
 
 class Engine {
@@ -30,6 +71,9 @@ public:
     Engine();
     ~Engine();
 
+    void configure(const EngineOptions& engineOptions);
+    int getExitCode() const { return exitCode; }
+
     bool initialize();
     void run();
     void handleEvents();
@@ -37,18 +81,15 @@ public:
     void render();
     void cleanup();
 
-    void handleKeyPress(SDL_Keycode key);
-    void handleKeyRelease(SDL_Keycode key);
     void handleMouseMotion(int x, int y);
     void handleMouseWheel(int y);
 
     void toggleFullscreen();
     void toggleGravityMode(const std::string& onText, const std::string& offText, float speed, float acceleration);
     void startSnakeGame(GameMode mode, int customTime = 120, int customFoodGoal = 20);
+    void startWorldGame(int worldSizeCells);
     void resetSnakeGame();
     void spawnFood();
-    void moveSnake();
-    void checkCollision();
     void saveScore();
     void loadScores();
     void setBackgroundColor(const std::string& colorName);
@@ -57,16 +98,64 @@ public:
     void renderConfetti();
     void renderSnakeGame();
     void drawTextBox();
-    void renderScoreboard();
+    void drawInputText();
     void updateSnakeGame();
+    void scheduleSnakeStep();
+    void scheduleCountdown(Uint32 firstTickMs);
+    void startConfettiTimer(Uint32 durationMs);
+    void startConfetti(int count = 50);
+    void emitConfetti();
+    void startStressScenario();
+    void driveStress();
+    void endSnakeGame();
+    Task gameOverSequence();
     void showScoreboard();
+    void updateCamera();
+    void captureSnapshot(Snapshot& snapshot) const;
+    void restoreSnapshot(const Snapshot& snapshot);
+    void recordRewindFrame();
+    void broadcastTick();
+    void registerMetrics();
+    void recordFrameMetrics(double frameMs);
+    void rewindStep();
+    void clearRewindHistory();
+    void quickSave();
+    void quickLoad();
+    int arenaWidth() const { return worldMode ? world.pixelWidth() : windowWidth; }
+    int arenaHeight() const { return worldMode ? world.pixelHeight() : windowHeight; }
+    void drawText(const char* text, int x, int y, SDL_Color color, TTF_Font* textFont, bool centered = false, const SDL_Rect* clip = nullptr);
+    void copyText(SDL_Texture* texture, const SDL_Rect& textRect, const SDL_Rect* clip, bool destroyAfter);
+    SDL_Surface* bakeText(const char* text, SDL_Color color, TTF_Font* textFont) const;
+    void adoptText(BakedText& baked);
+    void fillRect(const SDL_Rect& rect, SDL_Color color);
+    void fillRects(const SDL_Rect* rects, int count, SDL_Color color);
+    void clearTextCache();
+    void endFrameAllocations();
+    void driveInjectedGame();
+    QualityLevel qualityLevel() const { return governor.level(); }
 
 private:
+    friend class SandboxScene;
+    friend class SnakeScene;
+    friend class ConsoleScene;
+    friend class HelpScene;
+    friend class NameEntryScene;
+    friend class ScoreboardScene;
+
+    TextCacheEntry* findCachedText(const char* text, SDL_Color color, TTF_Font* textFont, TextCacheEntry*& oldest);
+    void storeCachedText(TextCacheEntry* entry, const char* text, SDL_Color color, TTF_Font* textFont, SDL_Texture* texture, int width, int height);
+
     SDL_Window* window;
     SDL_Renderer* renderer;
     TTF_Font* font;
+    TTF_Font* boldFont;
+    // Separate handles for the scene loader thread; TTF_Font is not thread-safe.
+    TTF_Font* loaderFont;
+    TTF_Font* loaderBoldFont;
 
+    EngineOptions options;
     bool isRunning;
+    int exitCode;
     int windowWidth, windowHeight;
 
     // Rectangle properties
@@ -92,31 +181,96 @@ private:
     bool gameOver;
     int score;
     int timer;
-    Uint32 startTime;
     bool isPaused;
-    std::vector<SDL_Point> snakeBody;
+    SnakeBody snakeBody;
     SDL_Point foodPosition;
 
+    // Large scrolling world (play world); otherwise the arena is the window
+    World world;
+    bool worldMode;
+    SDL_Rect camera;
+
     // FPS tracking
     int frameCount;
-    Uint32 lastFPSUpdateTime;
     int fps;
 
+    // Snake steps, the countdown, confetti expiry and the FPS window
+    TimerWheel timers;
+    TimerId snakeStepTimer;
+    TimerId countdownTimer;
+    TimerId confettiTimer;
+
+    // Multi-frame sequences, e.g. game over -> name entry -> scoreboard
+    TaskScheduler tasks;
+    TaskEvent nameEntered;
+    TaskId gameOverTask;
+
+    // Snapshots: liveSnapshot is the latest capture, rewindBuffer holds
+    // backward deltas from it to earlier frames
+    Snapshot liveSnapshot;
+    Snapshot workSnapshot;
+    bool hasLiveSnapshot;
+    SnapshotRing rewindBuffer;
+    std::vector<Uint8> snapshotScratch;
+    std::vector<Uint8> snapshotRecord;
+    std::vector<Uint8> quickSaveData;
+    bool rewinding;
+
+    AudioMixer audio;
+    QualityGovernor governor;
+    SoftRasterizer raster;
+    SpectatorRelay spectators;
+    FrameCapture capture;
+    StallWatchdog watchdog;
+
+    // Exported through --metrics-port / --metrics-file
+    MetricsRegistry metrics;
+    MetricsExporter metricsExporter;
+    MetricHistogram frameTimeMetric{ 1.0, 2.0, 4.0, 8.0, 12.0, 16.0, 25.0, 33.0, 50.0, 100.0 };
+    MetricCounter framesMetric;
+    MetricCounter simTicksMetric;
+    MetricGauge fpsMetric;
+    MetricGauge snakeLengthMetric;
+    MetricGauge particlesMetric;
+    MetricGauge spectatorsMetric;
+    MetricCounter allocationsMetric;
+    MetricCounter allocatedBytesMetric;
+    MetricGauge liveHeapMetric;
+    MetricHistogram scoreSaveMetric{ 0.5, 1.0, 2.0, 5.0, 10.0, 25.0, 50.0, 100.0, 250.0 };
+    int hudScore;
+    int hudTimer;
+    Uint32 hudRefreshFrame;
+    LatencyTracker latency;
+    InputInjector inputInjector;
+
+    // Per-frame transient memory
+    FrameArena frameArena;
+    std::vector<TextCacheEntry> textCache;
+    Uint32 frameIndex;
+
+    // Scenes; the stack decides what is updated, drawn and gets input
+    SceneStack scenes;
+    SandboxScene sandboxScene;
+    SnakeScene snakeScene;
+    ConsoleScene consoleScene;
+    HelpScene helpScene;
+    NameEntryScene nameEntryScene;
+    ScoreboardScene scoreboardScene;
+
     // Scoreboard
-    std::vector<ScoreEntry> mode1Scores;
-    std::vector<ScoreEntry> mode2Scores;
-    bool askingForName;
-    bool showingScoreboard;
+    ScoreTable mode1Scores;
+    ScoreTable mode2Scores;
+    size_t savedScoreRow;       // where saveScore() put the last entry
+    ScoreWriter scoreWriter;
 
     // Confetti effects
     bool showConfetti;
-    Uint32 confettiStartTime;
+    int pendingConfetti;
+    std::mt19937 confettiRng;
     std::vector<Confetti> confettiParticles;
 
     // UI
-    bool showTextBox;
     std::string inputText;
-    bool showHelp;
     SDL_Color backgroundColor;
 
     // Game logic
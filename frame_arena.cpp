@@ -0,0 +1,131 @@
+#include "frame_arena.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+FrameArena::FrameArena(size_t initialCapacity)
+    : buffer(nullptr),
+    bufferSize(initialCapacity),
+    offset(0),
+    peakBytes(0),
+    overflowBytes(0),
+    overflowBlocks(nullptr) {
+    buffer = static_cast<char*>(std::malloc(bufferSize));
+    if (!buffer) throw std::bad_alloc();
+}
+
+FrameArena::~FrameArena() {
+    reset();
+    std::free(buffer);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    size_t start = alignUp(offset, alignment);
+    if (start + size <= bufferSize) {
+        offset = start + size;
+        return buffer + start;
+    }
+
+    // Out of room for this frame: chain a heap block and remember how much we
+    // needed so reset() can size the buffer to fit next time.
+    size_t headerSize = alignUp(sizeof(OverflowBlock), alignment);
+    OverflowBlock* block = static_cast<OverflowBlock*>(std::malloc(headerSize + size));
+    if (!block) throw std::bad_alloc();
+    block->next = overflowBlocks;
+    overflowBlocks = block;
+    overflowBytes += size + alignment;
+    return reinterpret_cast<char*>(block) + headerSize;
+}
+
+void FrameArena::reset() {
+    size_t frameBytes = used();
+    peakBytes = std::max(peakBytes, frameBytes);
+
+    while (overflowBlocks) {
+        OverflowBlock* next = overflowBlocks->next;
+        std::free(overflowBlocks);
+        overflowBlocks = next;
+    }
+
+    if (overflowBytes > 0) {
+        size_t newSize = bufferSize;
+        while (newSize < frameBytes) newSize *= 2;
+        char* grown = static_cast<char*>(std::malloc(newSize));
+        if (grown) {
+            std::free(buffer);
+            buffer = grown;
+            bufferSize = newSize;
+        }
+    }
+
+    offset = 0;
+    overflowBytes = 0;
+}
+
+TextBuilder::TextBuilder(char* buffer, size_t size)
+    : data(buffer), size(size), len(0) {
+    if (size > 0) data[0] = '\0';
+}
+
+TextBuilder& TextBuilder::append(const char* text) {
+    return append(text, std::strlen(text));
+}
+
+TextBuilder& TextBuilder::append(const char* text, size_t count) {
+    if (size == 0) return *this;
+    size_t room = size - 1 - len;
+    if (count > room) count = room;
+    std::memcpy(data + len, text, count);
+    len += count;
+    data[len] = '\0';
+    return *this;
+}
+
+TextBuilder& TextBuilder::append(char c) {
+    return append(&c, 1);
+}
+
+TextBuilder& TextBuilder::append(long long value) {
+    char digits[24];
+    int count = 0;
+    unsigned long long magnitude = value < 0 ? 0ull - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+    do {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) digits[count++] = '-';
+
+    char text[24];
+    for (int i = 0; i < count; i++) {
+        text[i] = digits[count - 1 - i];
+    }
+    return append(text, static_cast<size_t>(count));
+}
+
+TextBuilder& TextBuilder::padTo(size_t column) {
+    while (len < column && len + 1 < size) {
+        data[len++] = ' ';
+    }
+    if (size > 0) data[len] = '\0';
+    return *this;
+}
+
+TextBuilder& TextBuilder::appendRight(long long value, size_t width) {
+    size_t digits = 1;
+    for (long long v = value < 0 ? -(value / 10) : value / 10; v > 0; v /= 10) digits++;
+    if (value < 0) digits++;
+    if (digits < width) padTo(len + width - digits);
+    return append(value);
+}
+
+void TextBuilder::clear() {
+    len = 0;
+    if (size > 0) data[0] = '\0';
+}
@@ -0,0 +1,111 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Linear allocator for data that only lives until the end of the current frame.
+// Allocation is a pointer bump; everything is released at once by reset().
+// If a frame outgrows the buffer, the extra requests are served from overflow
+// blocks and the buffer is grown on the next reset, so steady-state frames never
+// touch the heap.
+class FrameArena {
+public:
+    explicit FrameArena(size_t initialCapacity = 64 * 1024);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    char* allocateText(size_t size) { return static_cast<char*>(allocate(size, 1)); }
+    void reset();
+
+    size_t used() const { return offset + overflowBytes; }
+    size_t capacity() const { return bufferSize; }
+    size_t peakUsage() const { return peakBytes; }
+
+private:
+    struct OverflowBlock {
+        OverflowBlock* next;
+    };
+
+    char* buffer;
+    size_t bufferSize;
+    size_t offset;
+    size_t peakBytes;
+    size_t overflowBytes;
+    OverflowBlock* overflowBlocks;
+};
+
+// STL allocator handing out frame arena memory. deallocate() is a no-op; the
+// memory comes back when the arena is reset.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template <typename U> friend class ArenaAllocator;
+    FrameArena* arena;
+};
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Allocation-free text formatting into a caller-owned buffer. Output that does
+// not fit is truncated; the buffer is always null-terminated.
+class TextBuilder {
+public:
+    TextBuilder(char* buffer, size_t size);
+
+    TextBuilder& append(const char* text);
+    TextBuilder& append(const char* text, size_t count);
+    TextBuilder& append(const std::string& text) { return append(text.data(), text.size()); }
+    TextBuilder& append(char c);
+    TextBuilder& append(long long value);
+    TextBuilder& append(int value) { return append(static_cast<long long>(value)); }
+    TextBuilder& append(size_t value) { return append(static_cast<long long>(value)); }
+
+    // Pads with spaces up to an absolute column; does nothing if already past it.
+    TextBuilder& padTo(size_t column);
+    // Right-aligns a number inside a field of the given width.
+    TextBuilder& appendRight(long long value, size_t width);
+
+    void clear();
+    const char* c_str() const { return data; }
+    size_t length() const { return len; }
+    bool empty() const { return len == 0; }
+
+private:
+    char* data;
+    size_t size;
+    size_t len;
+};
+
+template <size_t N>
+class FixedText : public TextBuilder {
+public:
+    FixedText() : TextBuilder(storage, N) {}
+    FixedText(const FixedText&) = delete;
+    FixedText& operator=(const FixedText&) = delete;
+
+private:
+    char storage[N];
+};
+
+#endif // FRAME_ARENA_H
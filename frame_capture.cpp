@@ -0,0 +1,356 @@
+#include "frame_capture.h"
+#include "log.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    const int MIN_REPEAT = 3;   // shorter runs are cheaper as literals
+
+    void putVarint(Uint8*& out, size_t value) {
+        while (value >= 0x80) {
+            *out++ = static_cast<Uint8>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<Uint8>(value);
+    }
+
+    bool getVarint(const Uint8*& in, const Uint8* end, size_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && in < end; shift += 7) {
+            Uint8 byte = *in++;
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    void putPixel(Uint8*& out, Uint32 pixel) {
+        pixel = SDL_SwapLE32(pixel);
+        std::memcpy(out, &pixel, sizeof(pixel));
+        out += sizeof(pixel);
+    }
+
+    void putLE(Uint8*& out, Uint32 value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            *out++ = static_cast<Uint8>(value >> (8 * i));
+        }
+    }
+
+    Uint32 getLE(const Uint8* in, int bytes) {
+        Uint32 value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= static_cast<Uint32>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    SDL_Surface* wrapPixels(const Uint32* pixels, int width, int height) {
+        return SDL_CreateRGBSurfaceWithFormatFrom(const_cast<Uint32*>(pixels), width, height, 32,
+            width * static_cast<int>(sizeof(Uint32)), SDL_PIXELFORMAT_ARGB8888);
+    }
+}
+
+size_t encodeCaptureFrame(const Uint32* pixels, const Uint32* reference, size_t count, std::vector<Uint8>& out) {
+    // Worst case: every pixel a literal plus one token per 2 pixels.
+    size_t start = out.size();
+    out.resize(start + count * sizeof(Uint32) + count / 2 + 16);
+    Uint8* write = out.data() + start;
+
+    auto delta = [&](size_t i) { return reference ? pixels[i] ^ reference[i] : pixels[i]; };
+    size_t i = 0;
+    while (i < count) {
+        Uint32 value = delta(i);
+        size_t run = 1;
+        while (i + run < count && delta(i + run) == value) run++;
+        if (run >= MIN_REPEAT) {
+            putVarint(write, (run - 1) << 1 | 1);
+            putPixel(write, value);
+            i += run;
+            continue;
+        }
+
+        // Literal run up to the next repeat worth coding.
+        size_t end = i + run;
+        while (end < count) {
+            Uint32 next = delta(end);
+            if (end + MIN_REPEAT <= count && delta(end + 1) == next && delta(end + 2) == next) break;
+            end++;
+        }
+        putVarint(write, (end - i - 1) << 1);
+        for (; i < end; i++) putPixel(write, delta(i));
+    }
+
+    out.resize(write - out.data());
+    return out.size() - start;
+}
+
+bool decodeCaptureFrame(const Uint8* payload, size_t size, Uint32* pixels, size_t count) {
+    const Uint8* in = payload;
+    const Uint8* end = payload + size;
+    size_t i = 0;
+    while (in < end) {
+        size_t token;
+        if (!getVarint(in, end, token)) return false;
+        size_t run = (token >> 1) + 1;
+        if (run > count - i) return false;
+        if (token & 1) {
+            if (end - in < 4) return false;
+            Uint32 value = getLE(in, 4);
+            in += 4;
+            for (size_t k = 0; k < run; k++) pixels[i++] ^= value;
+        }
+        else {
+            if (static_cast<size_t>(end - in) < run * 4) return false;
+            for (size_t k = 0; k < run; k++, in += 4) pixels[i++] ^= getLE(in, 4);
+        }
+    }
+    return i == count;
+}
+
+FrameCapture::FrameCapture()
+    : file(nullptr),
+    stopping(false),
+    reference(nullptr),
+    framesSinceKeyframe(0),
+    captured(0),
+    dropped(0),
+    written(0),
+    bytesWritten(0),
+    rawBytes(0),
+    screenshots(0),
+    readbackMs(0.0) {
+    for (int i = 0; i < POOL_FRAMES; i++) {
+        pool.push_back(new Frame());
+    }
+}
+
+FrameCapture::~FrameCapture() {
+    close();
+    for (Frame* frame : pool) delete frame;
+}
+
+bool FrameCapture::open(const std::string& path) {
+    if (isRecording()) return true;
+    std::FILE* opened = std::fopen(path.c_str(), "wb");
+    if (!opened) {
+        LOG_ERROR("Capture: could not create {}", path);
+        return false;
+    }
+    Uint8 header[8];
+    Uint8* out = header;
+    putLE(out, FILE_MAGIC, 4);
+    putLE(out, FILE_VERSION, 4);
+    std::fwrite(header, 1, sizeof(header), opened);
+
+    startWorker();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        file = opened;
+        framesSinceKeyframe = 0;
+    }
+    LOG_INFO("Capture: recording to {}", path);
+    return true;
+}
+
+void FrameCapture::close() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+
+    if (reference) {
+        pool.push_back(reference);
+        reference = nullptr;
+    }
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    screenshotPath.clear();
+}
+
+void FrameCapture::requestScreenshot(const std::string& path) {
+    startWorker();
+    screenshotPath = path;
+}
+
+void FrameCapture::startWorker() {
+    if (worker.joinable()) return;
+    stopping = false;
+    worker = std::thread(&FrameCapture::workerLoop, this);
+}
+
+void FrameCapture::captureFrame(SDL_Renderer* renderer, Uint32 frameIndex) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    captured++;
+    Frame* frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pool.empty()) {
+            frame = pool.back();
+            pool.pop_back();
+        }
+    }
+    if (!frame) {
+        // Keep a pending screenshot for the next frame.
+        dropped++;
+        return;
+    }
+
+    int width = 0, height = 0;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    frame->pixels.resize(static_cast<size_t>(width) * height);
+    frame->width = width;
+    frame->height = height;
+    frame->frameIndex = frameIndex;
+    frame->timeMs = SDL_GetTicks();
+    frame->record = isRecording();
+    frame->screenshotPath.swap(screenshotPath);
+    screenshotPath.clear();
+
+    bool ok = SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_ARGB8888, frame->pixels.data(),
+        width * static_cast<int>(sizeof(Uint32))) == 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ok) queue.push_back(frame);
+        else pool.push_back(frame);
+    }
+    if (ok) {
+        wake.notify_one();
+    }
+    else {
+        LOG_ERROR("Capture: could not read the frame back: {}", SDL_GetError());
+    }
+    readbackMs += (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void FrameCapture::workerLoop() {
+    for (;;) {
+        Frame* frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) break;
+            frame = queue.front();
+            queue.erase(queue.begin());
+        }
+
+        if (!frame->screenshotPath.empty()) {
+            saveScreenshot(*frame);
+        }
+        if (frame->record) {
+            // Keeps the frame as the next delta base and hands back the old one.
+            writeFrame(*frame);
+            std::swap(frame, reference);
+        }
+        if (frame) {
+            std::lock_guard<std::mutex> lock(mutex);
+            pool.push_back(frame);
+        }
+    }
+}
+
+void FrameCapture::writeFrame(Frame& frame) {
+    size_t count = frame.pixels.size();
+    bool keyframe = !reference || reference->width != frame.width || reference->height != frame.height ||
+        framesSinceKeyframe >= KEYFRAME_INTERVAL;
+    framesSinceKeyframe = keyframe ? 1 : framesSinceKeyframe + 1;
+
+    encoded.resize(FRAME_HEADER_BYTES);
+    size_t payloadBytes = encodeCaptureFrame(frame.pixels.data(), keyframe ? nullptr : reference->pixels.data(), count, encoded);
+    Uint8* out = encoded.data();
+    putLE(out, static_cast<Uint32>(payloadBytes), 4);
+    putLE(out, frame.frameIndex, 4);
+    putLE(out, frame.timeMs, 4);
+    putLE(out, static_cast<Uint32>(frame.width), 2);
+    putLE(out, static_cast<Uint32>(frame.height), 2);
+    *out = keyframe ? 1 : 0;
+
+    std::fwrite(encoded.data(), 1, encoded.size(), file);
+    written++;
+    bytesWritten += encoded.size();
+    rawBytes += count * sizeof(Uint32);
+}
+
+void FrameCapture::saveScreenshot(const Frame& frame) {
+    SDL_Surface* surface = wrapPixels(frame.pixels.data(), frame.width, frame.height);
+    if (surface && SDL_SaveBMP(surface, frame.screenshotPath.c_str()) == 0) {
+        screenshots++;
+        LOG_INFO("Screenshot saved to {}", frame.screenshotPath);
+    }
+    else {
+        LOG_ERROR("Screenshot could not be saved to {}: {}", frame.screenshotPath, SDL_GetError());
+    }
+    if (surface) SDL_FreeSurface(surface);
+}
+
+FrameCapture::Stats FrameCapture::stats() const {
+    Stats result;
+    result.framesCaptured = captured.load();
+    result.framesDropped = dropped.load();
+    result.framesWritten = written.load();
+    result.bytesWritten = bytesWritten.load();
+    result.rawBytes = rawBytes.load();
+    result.screenshots = screenshots.load();
+    result.readbackMs = readbackMs;
+    return result;
+}
+
+int extractCapture(const std::string& path) {
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) {
+        LOG_ERROR("Capture: could not open {}", path);
+        return 1;
+    }
+    Uint8 header[8];
+    if (std::fread(header, 1, sizeof(header), in) != sizeof(header) ||
+        getLE(header, 4) != FrameCapture::FILE_MAGIC || getLE(header + 4, 4) != FrameCapture::FILE_VERSION) {
+        LOG_ERROR("Capture: {} is not a frame recording", path);
+        std::fclose(in);
+        return 1;
+    }
+
+    std::string prefix = path.substr(0, path.find_last_of('.') == std::string::npos ? path.size() : path.find_last_of('.'));
+    std::vector<Uint8> payload;
+    std::vector<Uint32> pixels;
+    int width = 0, height = 0;
+    int frames = 0;
+    bool ok = true;
+    Uint8 frameHeader[FrameCapture::FRAME_HEADER_BYTES];
+    while (std::fread(frameHeader, 1, sizeof(frameHeader), in) == sizeof(frameHeader)) {
+        payload.resize(getLE(frameHeader, 4));
+        Uint32 frameIndex = getLE(frameHeader + 4, 4);
+        int frameWidth = static_cast<int>(getLE(frameHeader + 12, 2));
+        int frameHeight = static_cast<int>(getLE(frameHeader + 14, 2));
+        bool keyframe = (frameHeader[16] & 1) != 0;
+        if (std::fread(payload.data(), 1, payload.size(), in) != payload.size()) {
+            ok = false;
+            break;
+        }
+        if (keyframe) {
+            width = frameWidth;
+            height = frameHeight;
+            pixels.assign(static_cast<size_t>(width) * height, 0);
+        }
+        if (frameWidth != width || frameHeight != height ||
+            !decodeCaptureFrame(payload.data(), payload.size(), pixels.data(), pixels.size())) {
+            ok = false;
+            break;
+        }
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "-%06u.bmp", frameIndex);
+        SDL_Surface* surface = wrapPixels(pixels.data(), width, height);
+        if (!surface || SDL_SaveBMP(surface, (prefix + name).c_str()) != 0) ok = false;
+        if (surface) SDL_FreeSurface(surface);
+        if (!ok) break;
+        frames++;
+    }
+    std::fclose(in);
+
+    LOG_INFO("Capture: extracted {} frames from {} to {}-NNNNNN.bmp{}", frames, path, prefix, ok ? "" : " (stopped at a damaged frame)");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records presented frames and takes screenshots without stalling the game
+// loop on compression or disk. The main thread only reads the back buffer
+// into one of POOL_FRAMES reused buffers; a worker thread compresses and
+// writes it. When every buffer is still queued the frame is dropped and
+// counted, so a slow disk lowers the recording frame rate, not the game's.
+//
+// Recording container, little-endian:
+//   file header  { Uint32 magic 'SFRC', Uint32 version }
+//   per frame    { Uint32 payloadBytes, Uint32 frameIndex, Uint32 timeMs,
+//                  Uint16 width, Uint16 height, Uint8 flags } + payload
+// Pixels are ARGB8888. A payload is the frame XOR the previous written frame
+// (or the frame itself when flags bit 0 marks a keyframe), run-length coded
+// as 32-bit pixels: a varint token (count - 1) << 1 | repeat, then one pixel
+// for a repeat or count pixels for a literal run. Unchanged areas cost a few
+// bytes. Screenshots are written as BMP files.
+class FrameCapture {
+public:
+    static const int POOL_FRAMES = 4;          // including the delta base the worker holds
+    static const int KEYFRAME_INTERVAL = 120;  // written frames between keyframes
+    static const Uint32 FILE_MAGIC = 0x43524653;  // "SFRC"
+    static const Uint32 FILE_VERSION = 1;
+    static const int FRAME_HEADER_BYTES = 17;
+
+    struct Stats {
+        Uint64 framesCaptured;
+        Uint64 framesDropped;       // no free buffer
+        Uint64 framesWritten;
+        Uint64 bytesWritten;        // compressed recording bytes
+        Uint64 rawBytes;            // the same frames uncompressed
+        Uint64 screenshots;
+        double readbackMs;          // main-thread time spent in captureFrame
+    };
+
+    FrameCapture();
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Starts recording every presented frame to path.
+    bool open(const std::string& path);
+    void close();                                   // writes out queued frames first
+    bool isRecording() const { return file != nullptr; }
+    bool isActive() const { return worker.joinable(); }    // recording or has taken a screenshot
+
+    // The next captured frame is also saved to path as a BMP.
+    void requestScreenshot(const std::string& path);
+    bool wantsFrame() const { return file != nullptr || !screenshotPath.empty(); }
+
+    // Main thread, after drawing and before SDL_RenderPresent.
+    void captureFrame(SDL_Renderer* renderer, Uint32 frameIndex);
+
+    Stats stats() const;
+
+private:
+    struct Frame {
+        std::vector<Uint32> pixels;
+        int width, height;
+        Uint32 frameIndex;
+        Uint32 timeMs;
+        bool record;
+        std::string screenshotPath;
+    };
+
+    void startWorker();
+    void workerLoop();
+    void writeFrame(Frame& frame);
+    void saveScreenshot(const Frame& frame);
+
+    std::FILE* file;
+    std::string screenshotPath;
+    std::thread worker;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Frame*> pool;       // free buffers
+    std::vector<Frame*> queue;      // captured, oldest first
+    bool stopping;
+
+    // Worker only
+    Frame* reference;               // last frame written, base of the next delta
+    int framesSinceKeyframe;
+    std::vector<Uint8> encoded;
+
+    std::atomic<Uint64> captured;
+    std::atomic<Uint64> dropped;
+    std::atomic<Uint64> written;
+    std::atomic<Uint64> bytesWritten;
+    std::atomic<Uint64> rawBytes;
+    std::atomic<Uint64> screenshots;
+    double readbackMs;
+};
+
+// Appends the compressed form of pixels (against reference, or as a keyframe
+// when reference is null) to out. Returns the payload size.
+size_t encodeCaptureFrame(const Uint32* pixels, const Uint32* reference, size_t count, std::vector<Uint8>& out);
+// Applies a payload to pixels in place: pixels holds the previous frame (zeros
+// for a keyframe) and ends up holding this one. False if the payload is corrupt.
+bool decodeCaptureFrame(const Uint8* payload, size_t size, Uint32* pixels, size_t count);
+
+// Writes every frame of a recording as PATH-000000.bmp and so on next to it.
+// Returns the process exit code.
+int extractCapture(const std::string& path);
+
+#endif // FRAME_CAPTURE_H
@@ -0,0 +1,175 @@
+#include "game_schema.h"
+#include "log.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace {
+    const double MIN_SECONDS = 0.25;   // per measurement
+
+    // Runs work until MIN_SECONDS have passed; returns seconds per run.
+    template <typename Work>
+    double timeRuns(Work work) {
+        auto start = std::chrono::steady_clock::now();
+        int runs = 0;
+        double seconds = 0.0;
+        do {
+            work();
+            runs++;
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (seconds < MIN_SECONDS);
+        return seconds / runs;
+    }
+
+    // Encodes values (against base when given), decodes them again, checks
+    // them with same() and prints sizes and throughput.
+    template <typename T, typename Same>
+    bool measure(const char* name, const std::vector<T>& values, const std::vector<T>* base, Same same) {
+        std::vector<Uint8> packed;
+        std::vector<T> decoded;
+        double encodeSeconds = timeRuns([&] {
+            packed.clear();
+            BitWriter writer(packed);
+            if (base) packArrayDelta(writer, values, *base);
+            else packArray(writer, values);
+            writer.finish();
+        });
+        bool ok = true;
+        double decodeSeconds = timeRuns([&] {
+            BitReader reader(packed.data(), packed.size());
+            ok = base ? unpackArrayDelta(reader, decoded, *base, values.size()) : unpackArray(reader, decoded, values.size());
+        });
+
+        ok = ok && decoded.size() == values.size();
+        for (size_t i = 0; ok && i < values.size(); i++) {
+            ok = same(values[i], decoded[i]);
+        }
+
+        double rawBytes = static_cast<double>(values.size() * sizeof(T));
+        LOG_INFO("  {}: {} x {} B -> {} B each, encode {} GB/s, decode {} GB/s{}",
+            name, values.size(), sizeof(T), static_cast<double>(packed.size()) / values.size(),
+            rawBytes / encodeSeconds / 1e9, rawBytes / decodeSeconds / 1e9, ok ? "" : "  ROUND TRIP FAILED");
+        return ok;
+    }
+
+    bool near(float a, float b, float tolerance) {
+        return std::fabs(a - b) <= tolerance;
+    }
+}
+
+int runSerializerBenchmark() {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(0.0f, 1920.0f);
+    std::uniform_real_distribution<float> speed(-20.0f, 20.0f);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    std::vector<Confetti> confetti(200000);
+    for (Confetti& particle : confetti) {
+        particle = { position(rng), position(rng), speed(rng), speed(rng),
+            { static_cast<Uint8>(byte(rng)), static_cast<Uint8>(byte(rng)), static_cast<Uint8>(byte(rng)), 255 } };
+    }
+    // One frame later: every particle moved.
+    std::vector<Confetti> confettiNext = confetti;
+    for (Confetti& particle : confettiNext) {
+        particle.x += particle.velocityX;
+        particle.y += particle.velocityY;
+        particle.velocityY += 0.1f;
+    }
+    // Half a step of the coarsest quantized field, plus float slack.
+    const float positionTolerance = 8192.0f / ((1 << 20) - 1) * 0.51f;
+    const float speedTolerance = 512.0f / ((1 << 16) - 1) * 0.51f;
+    auto sameConfetti = [&](const Confetti& a, const Confetti& b) {
+        return near(a.x, b.x, positionTolerance) && near(a.y, b.y, positionTolerance) &&
+            near(a.velocityX, b.velocityX, speedTolerance) && near(a.velocityY, b.velocityY, speedTolerance) &&
+            a.color.r == b.color.r && a.color.g == b.color.g && a.color.b == b.color.b && a.color.a == b.color.a;
+    };
+    // Delta decoding starts from the decoded baseline, as a receiver would.
+    std::vector<Confetti> confettiBase;
+    {
+        std::vector<Uint8> packed;
+        BitWriter writer(packed);
+        packArray(writer, confetti);
+        writer.finish();
+        BitReader reader(packed.data(), packed.size());
+        unpackArray(reader, confettiBase, confetti.size());
+    }
+
+    // A long random walk, as in the stress scenario.
+    SnakeBody body;
+    body.reset(2000, 2000, RIGHT);
+    std::uniform_int_distribution<int> turn(0, 3);
+    std::uniform_int_distribution<int> runLength(1, 12);
+    Direction direction = RIGHT;
+    for (int run = 0; run < 200000; run++) {
+        Direction next = static_cast<Direction>(turn(rng));
+        if ((direction == LEFT || direction == RIGHT) == (next == LEFT || next == RIGHT)) {
+            next = (direction == LEFT || direction == RIGHT) ? UP : LEFT;
+        }
+        direction = next;
+        for (int step = runLength(rng); step > 0; step--) {
+            body.extendHead(direction);
+        }
+    }
+    std::vector<SnakeRun> runs;
+    body.copyRuns(runs);
+    std::vector<SnakeRun> runsNext = runs;
+    runsNext.back().length++;
+    auto sameRun = [](const SnakeRun& a, const SnakeRun& b) {
+        return a.tailX == b.tailX && a.tailY == b.tailY && a.length == b.length && a.direction == b.direction;
+    };
+
+    std::vector<ScoreEntry> scores(50000);
+    for (size_t i = 0; i < scores.size(); i++) {
+        scores[i] = { "player" + std::to_string(i), static_cast<int>(i % 40), static_cast<int>(i % 120) };
+    }
+    auto sameScore = [](const ScoreEntry& a, const ScoreEntry& b) {
+        return a.playerName == b.playerName && a.food == b.food && a.time == b.time;
+    };
+
+    std::vector<SnapshotHeader> headers(100000);
+    for (size_t i = 0; i < headers.size(); i++) {
+        SnapshotHeader& header = headers[i];
+        header = {};
+        header.snakeGameActive = 1;
+        header.currentMode = MODE_2;
+        header.snakeDirection = static_cast<Sint32>(i % 4);
+        header.snakeSpeed = 2;
+        header.score = static_cast<Sint32>(i % 500);
+        header.timer = 120;
+        header.foodGoal = 20;
+        header.foodX = static_cast<Sint32>(i * 37 % 1920);
+        header.foodY = static_cast<Sint32>(i * 53 % 1080);
+        header.msSinceSnakeMove = static_cast<Uint32>(i % 40);
+        header.rectX = 400;
+        header.rectY = 300;
+        header.gravitySpeed = 5.0f;
+        header.gravityAcceleration = 0.5f;
+        header.snakeFirstRun = i;
+    }
+    std::vector<SnapshotHeader> headersNext = headers;
+    for (SnapshotHeader& header : headersNext) {
+        header.msSinceSnakeMove = (header.msSinceSnakeMove + 16) % 40;
+        header.score++;
+    }
+    auto sameHeader = [](const SnapshotHeader& a, const SnapshotHeader& b) {
+        return a.snakeGameActive == b.snakeGameActive && a.gameOver == b.gameOver && a.isPaused == b.isPaused &&
+            a.currentMode == b.currentMode && a.snakeDirection == b.snakeDirection && a.snakeSpeed == b.snakeSpeed &&
+            a.score == b.score && a.timer == b.timer && a.foodGoal == b.foodGoal && a.foodX == b.foodX && a.foodY == b.foodY &&
+            a.msUntilCountdownTick == b.msUntilCountdownTick && a.msSinceSnakeMove == b.msSinceSnakeMove &&
+            a.showConfetti == b.showConfetti && a.msUntilConfettiEnd == b.msUntilConfettiEnd && a.gravityMode == b.gravityMode &&
+            a.rectX == b.rectX && a.rectY == b.rectY && a.velocityY == b.velocityY && a.gravitySpeed == b.gravitySpeed &&
+            a.gravityAcceleration == b.gravityAcceleration && a.isOnGround == b.isOnGround && a.worldMode == b.worldMode &&
+            a.snakeFirstRun == b.snakeFirstRun;
+    };
+
+    LOG_INFO("Serializer throughput (GB/s of in-memory structs):");
+    bool ok = true;
+    ok &= measure("confetti", confetti, static_cast<const std::vector<Confetti>*>(nullptr), sameConfetti);
+    ok &= measure("confetti delta", confettiNext, &confettiBase, sameConfetti);
+    ok &= measure("snake runs", runs, static_cast<const std::vector<SnakeRun>*>(nullptr), sameRun);
+    ok &= measure("snake runs delta", runsNext, &runs, sameRun);
+    ok &= measure("scores", scores, static_cast<const std::vector<ScoreEntry>*>(nullptr), sameScore);
+    ok &= measure("game state", headers, static_cast<const std::vector<SnapshotHeader>*>(nullptr), sameHeader);
+    ok &= measure("game state delta", headersNext, &headers, sameHeader);
+    return ok ? 0 : 1;
+}
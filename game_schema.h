@@ -0,0 +1,86 @@
+#ifndef GAME_SCHEMA_H
+#define GAME_SCHEMA_H
+
+#include "bit_pack.h"
+#include "game_types.h"
+#include "snake_body.h"
+#include "snapshot.h"
+
+// Bit-packed layouts of the engine structs. Positions and velocities are
+// quantized to well under a pixel; everything else round-trips exactly.
+
+template <>
+struct Schema<SDL_Color> {
+    typedef FieldList<
+        PackBits<&SDL_Color::r, 8>,
+        PackBits<&SDL_Color::g, 8>,
+        PackBits<&SDL_Color::b, 8>,
+        PackBits<&SDL_Color::a, 8>> Fields;
+};
+
+template <>
+struct Schema<ScoreEntry> {
+    typedef FieldList<
+        PackString<&ScoreEntry::playerName, 64>,
+        PackVarint<&ScoreEntry::food>,
+        PackVarint<&ScoreEntry::time>> Fields;
+};
+
+// Screen positions within [-1024, 7168) to 1/128 px, velocities within
+// +-256 px per frame to 1/128 px.
+template <>
+struct Schema<Confetti> {
+    typedef FieldList<
+        PackQuantized<&Confetti::x, -1024, 7168, 20>,
+        PackQuantized<&Confetti::y, -1024, 7168, 20>,
+        PackQuantized<&Confetti::velocityX, -256, 256, 16>,
+        PackQuantized<&Confetti::velocityY, -256, 256, 16>,
+        PackStruct<&Confetti::color>> Fields;
+};
+
+template <>
+struct Schema<SnakeRun> {
+    typedef FieldList<
+        PackVarint<&SnakeRun::tailX>,
+        PackVarint<&SnakeRun::tailY>,
+        PackVarint<&SnakeRun::length>,
+        PackBits<&SnakeRun::direction, 2>> Fields;
+};
+
+// Game mode and round state. The magic, version and element counts belong to
+// the snapshot container and are left out.
+template <>
+struct Schema<SnapshotHeader> {
+    typedef FieldList<
+        PackBits<&SnapshotHeader::snakeGameActive, 1>,
+        PackBits<&SnapshotHeader::gameOver, 1>,
+        PackBits<&SnapshotHeader::isPaused, 1>,
+        PackBits<&SnapshotHeader::currentMode, 2>,
+        PackBits<&SnapshotHeader::snakeDirection, 2>,
+        PackVarint<&SnapshotHeader::snakeSpeed>,
+        PackVarint<&SnapshotHeader::score>,
+        PackVarint<&SnapshotHeader::timer>,
+        PackVarint<&SnapshotHeader::foodGoal>,
+        PackVarint<&SnapshotHeader::foodX>,
+        PackVarint<&SnapshotHeader::foodY>,
+        PackVarint<&SnapshotHeader::msUntilCountdownTick>,
+        PackVarint<&SnapshotHeader::msSinceSnakeMove>,
+        PackBits<&SnapshotHeader::showConfetti, 1>,
+        PackVarint<&SnapshotHeader::msUntilConfettiEnd>,
+        PackBits<&SnapshotHeader::gravityMode, 1>,
+        PackVarint<&SnapshotHeader::rectX>,
+        PackVarint<&SnapshotHeader::rectY>,
+        PackFloat<&SnapshotHeader::velocityY>,
+        PackFloat<&SnapshotHeader::gravitySpeed>,
+        PackFloat<&SnapshotHeader::gravityAcceleration>,
+        PackBits<&SnapshotHeader::isOnGround, 1>,
+        PackBits<&SnapshotHeader::worldMode, 1>,
+        PackVarint<&SnapshotHeader::snakeFirstRun>> Fields;
+};
+
+// Encodes and decodes large batches of each struct, whole and as deltas,
+// checks the round trip and prints throughput in GB/s of in-memory struct
+// data. Returns the process exit code.
+int runSerializerBenchmark();
+
+#endif // GAME_SCHEMA_H
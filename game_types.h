@@ -0,0 +1,22 @@
+#ifndef GAME_TYPES_H
+#define GAME_TYPES_H
+
+#include <SDL.h>
+#include <string>
+
+enum Direction { UP, DOWN, LEFT, RIGHT };
+enum GameMode { MODE_NONE, MODE_1, MODE_2, MODE_3 };
+
+struct ScoreEntry {
+    std::string playerName;
+    int food;
+    int time;
+};
+
+struct Confetti {
+    float x, y;
+    float velocityX, velocityY;
+    SDL_Color color;
+};
+
+#endif // GAME_TYPES_H
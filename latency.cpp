@@ -0,0 +1,164 @@
+#include "latency.h"
+#include <algorithm>
+#include <fstream>
+
+LatencyHistogram::LatencyHistogram()
+    : buckets(BUCKET_COUNT, 0),
+    total(0),
+    maxValue(0) {
+}
+
+void LatencyHistogram::record(Uint64 microseconds) {
+    Uint64 bucket = std::min<Uint64>(microseconds / BUCKET_US, BUCKET_COUNT - 1);
+    buckets[static_cast<size_t>(bucket)]++;
+    total++;
+    maxValue = std::max(maxValue, microseconds);
+}
+
+void LatencyHistogram::clear() {
+    std::fill(buckets.begin(), buckets.end(), 0);
+    total = 0;
+    maxValue = 0;
+}
+
+double LatencyHistogram::percentile(double fraction) const {
+    if (total == 0) return 0.0;
+    Uint64 target = static_cast<Uint64>(fraction * static_cast<double>(total - 1)) + 1;
+    Uint64 seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            // Report the bucket's upper edge so percentiles never under-state.
+            return (static_cast<double>(i) + 1.0) * BUCKET_US / 1000.0;
+        }
+    }
+    return maxValue / 1000.0;
+}
+
+LatencyTracker::LatencyTracker()
+    : enabled(false),
+    frequency(0),
+    awaitingSim(),
+    awaitingSimCount(0),
+    awaitingPresent(),
+    awaitingPresentCount(0),
+    droppedTags(0) {
+}
+
+void LatencyTracker::onInput(Uint32 eventTimestamp) {
+    if (!enabled) return;
+    if (!frequency) frequency = SDL_GetPerformanceFrequency();
+
+    if (awaitingSimCount == MAX_TAGS) {
+        droppedTags++;
+        return;
+    }
+
+    // SDL timestamps are in SDL_GetTicks() milliseconds; move the tag onto the
+    // performance counter so the rest of the path is measured precisely.
+    Uint32 ageMs = SDL_GetTicks() - eventTimestamp;
+    Uint64 now = SDL_GetPerformanceCounter();
+    awaitingSim[awaitingSimCount++] = { now - ageMs * frequency / 1000 };
+}
+
+void LatencyTracker::onSimStep() {
+    if (!enabled || awaitingSimCount == 0) return;
+
+    for (int i = 0; i < awaitingSimCount; i++) {
+        simHistogram.record(microsecondsSince(awaitingSim[i].startCounter));
+        if (awaitingPresentCount < MAX_TAGS) {
+            awaitingPresent[awaitingPresentCount++] = awaitingSim[i];
+        }
+        else {
+            droppedTags++;
+        }
+    }
+    awaitingSimCount = 0;
+}
+
+void LatencyTracker::onPresent() {
+    if (!enabled) return;
+
+    for (int i = 0; i < awaitingPresentCount; i++) {
+        presentHistogram.record(microsecondsSince(awaitingPresent[i].startCounter));
+    }
+    awaitingPresentCount = 0;
+}
+
+Uint64 LatencyTracker::microsecondsSince(Uint64 counter) const {
+    Uint64 now = SDL_GetPerformanceCounter();
+    return now > counter ? (now - counter) * 1000000 / frequency : 0;
+}
+
+void LatencyTracker::report(std::ostream& out) const {
+    const LatencyHistogram* histograms[] = { &simHistogram, &presentHistogram };
+    const char* names[] = { "event->sim", "event->present" };
+    out << "Input latency (ms):\n";
+    for (int i = 0; i < 2; i++) {
+        const LatencyHistogram& histogram = *histograms[i];
+        out << "  " << names[i] << ": n=" << histogram.count()
+            << " p50=" << histogram.percentile(0.50)
+            << " p95=" << histogram.percentile(0.95)
+            << " p99=" << histogram.percentile(0.99)
+            << " max=" << histogram.max() / 1000.0 << "\n";
+    }
+    if (droppedTags > 0) {
+        out << "  " << droppedTags << " inputs not tracked (too many in flight)\n";
+    }
+}
+
+bool LatencyTracker::writeCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) return false;
+
+    file << "metric,count,p50_ms,p95_ms,p99_ms,max_ms\n";
+    const LatencyHistogram* histograms[] = { &simHistogram, &presentHistogram };
+    const char* names[] = { "event_to_sim", "event_to_present" };
+    for (int i = 0; i < 2; i++) {
+        const LatencyHistogram& histogram = *histograms[i];
+        file << names[i] << "," << histogram.count() << "," << histogram.percentile(0.50) << ","
+            << histogram.percentile(0.95) << "," << histogram.percentile(0.99) << "," << histogram.max() / 1000.0 << "\n";
+    }
+    return true;
+}
+
+InputInjector::InputInjector()
+    : intervalMs(0),
+    nextInjectTime(0),
+    turnIndex(0),
+    heldKey(SDLK_UNKNOWN) {
+}
+
+void InputInjector::start(Uint32 interval) {
+    intervalMs = std::max<Uint32>(1, interval);
+    nextInjectTime = SDL_GetTicks() + intervalMs;
+    turnIndex = 0;
+}
+
+void InputInjector::update() {
+    if (!isActive()) return;
+
+    Uint32 now = SDL_GetTicks();
+    if (static_cast<Sint32>(now - nextInjectTime) < 0) return;
+    nextInjectTime = now + intervalMs;
+
+    // Turning clockwise keeps the snake circling near where it started.
+    static const SDL_Keycode turns[] = { SDLK_DOWN, SDLK_LEFT, SDLK_UP, SDLK_RIGHT };
+
+    SDL_Event event;
+    SDL_zero(event);
+    if (heldKey != SDLK_UNKNOWN) {
+        event.type = SDL_KEYUP;
+        event.key.state = SDL_RELEASED;
+        event.key.keysym.sym = heldKey;
+        SDL_PushEvent(&event);
+    }
+
+    heldKey = turns[turnIndex];
+    turnIndex = (turnIndex + 1) % 4;
+    SDL_zero(event);
+    event.type = SDL_KEYDOWN;
+    event.key.state = SDL_PRESSED;
+    event.key.keysym.sym = heldKey;
+    SDL_PushEvent(&event);
+}
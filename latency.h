@@ -0,0 +1,88 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <SDL.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Fixed-bucket histogram of durations in microseconds.
+class LatencyHistogram {
+public:
+    static const Uint32 BUCKET_US = 50;
+    static const int BUCKET_COUNT = 10000;   // 0 - 500 ms, the last bucket catches the rest
+
+    LatencyHistogram();
+
+    void record(Uint64 microseconds);
+    void clear();
+
+    Uint64 count() const { return total; }
+    Uint64 max() const { return maxValue; }
+    double percentile(double fraction) const;   // in milliseconds
+
+private:
+    std::vector<Uint32> buckets;
+    Uint64 total;
+    Uint64 maxValue;
+};
+
+// Follows input events through the frame: each steering key press is tagged
+// with its SDL timestamp, the tag is closed by the next simulation step that
+// applies it (event -> sim), and then by the SDL_RenderPresent that shows the
+// result (event -> present).
+class LatencyTracker {
+public:
+    LatencyTracker();
+
+    void setEnabled(bool on) { enabled = on; }
+    bool isEnabled() const { return enabled; }
+
+    void onInput(Uint32 eventTimestamp);
+    void onSimStep();
+    void onPresent();
+
+    const LatencyHistogram& eventToSim() const { return simHistogram; }
+    const LatencyHistogram& eventToPresent() const { return presentHistogram; }
+
+    void report(std::ostream& out) const;
+    bool writeCsv(const std::string& path) const;
+
+private:
+    struct Tag {
+        Uint64 startCounter;   // performance counter at the event's SDL timestamp
+    };
+
+    static const int MAX_TAGS = 32;
+
+    Uint64 microsecondsSince(Uint64 counter) const;
+
+    bool enabled;
+    Uint64 frequency;
+    Tag awaitingSim[MAX_TAGS];
+    int awaitingSimCount;
+    Tag awaitingPresent[MAX_TAGS];
+    int awaitingPresentCount;
+    Uint64 droppedTags;
+    LatencyHistogram simHistogram;
+    LatencyHistogram presentHistogram;
+};
+
+// Pushes synthetic arrow-key presses into the SDL event queue at a fixed
+// interval, so latency can be measured headless without a player.
+class InputInjector {
+public:
+    InputInjector();
+
+    void start(Uint32 intervalMs);
+    bool isActive() const { return intervalMs > 0; }
+    void update();
+
+private:
+    Uint32 intervalMs;
+    Uint32 nextInjectTime;
+    int turnIndex;
+    SDL_Keycode heldKey;
+};
+
+#endif // LATENCY_H
@@ -0,0 +1,168 @@
+#include "list_view.h"
+#include "engine.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace {
+    const double SCROLL_RATE = 14.0;       // per second; the view covers ~90% of the distance in 1/6 s
+    const int FAR_JUMP_PAGES = 3;          // longer scrolls skip ahead and ease in over this many pages
+    const SDL_Color TEXT_COLOR = { 255, 255, 255, 255 };
+    const SDL_Color SELECTION_COLOR = { 60, 60, 110, 255 };
+    const SDL_Color SCROLLBAR_COLOR = { 90, 90, 90, 255 };
+    const SDL_Color THUMB_COLOR = { 200, 200, 200, 255 };
+
+    bool startsWith(const std::string& name, const std::string& prefix) {
+        if (name.size() < prefix.size()) return false;
+        for (size_t i = 0; i < prefix.size(); i++) {
+            if (std::tolower(static_cast<unsigned char>(name[i])) != std::tolower(static_cast<unsigned char>(prefix[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+ListView::ListView()
+    : source(nullptr),
+    rowHeight(20),
+    pageRows(10),
+    scrollRow(0.0),
+    targetRow(0.0),
+    selected(npos),
+    highlightRow(npos),
+    searchState(SEARCH_IDLE),
+    searchNext(0),
+    searchLeft(0) {
+}
+
+void ListView::setSource(const ListSource* rowSource) {
+    source = rowSource;
+    scrollRow = targetRow = 0.0;
+    selected = npos;
+    highlightRow = npos;
+    searchState = SEARCH_IDLE;
+}
+
+double ListView::maxScroll() const {
+    size_t count = rowCount();
+    return count > static_cast<size_t>(pageRows) ? static_cast<double>(count - pageRows) : 0.0;
+}
+
+void ListView::scrollTo(double row, bool animate) {
+    targetRow = std::max(0.0, std::min(maxScroll(), row));
+    if (!animate) {
+        scrollRow = targetRow;
+        return;
+    }
+    // Scrolling through a million rows would only blur; land close and ease
+    // the last few pages instead.
+    double far = static_cast<double>(FAR_JUMP_PAGES * pageRows);
+    if (targetRow - scrollRow > far) scrollRow = targetRow - far;
+    else if (scrollRow - targetRow > far) scrollRow = targetRow + far;
+}
+
+void ListView::ensureVisible(size_t row) {
+    double top = static_cast<double>(row);
+    if (top < targetRow) {
+        scrollTo(top, true);
+    }
+    else if (top + 1 > targetRow + pageRows) {
+        scrollTo(top + 1 - pageRows, true);
+    }
+}
+
+void ListView::select(size_t row) {
+    size_t count = rowCount();
+    if (count == 0) return;
+    selected = std::min(row, count - 1);
+    ensureVisible(selected);
+}
+
+void ListView::moveSelection(long long rows) {
+    size_t count = rowCount();
+    if (count == 0) return;
+    if (selected == npos) {
+        select(static_cast<size_t>(targetRow));
+        return;
+    }
+    long long moved = static_cast<long long>(selected) + rows;
+    select(static_cast<size_t>(std::max(0LL, std::min(static_cast<long long>(count) - 1, moved))));
+}
+
+void ListView::scrollBy(double rows) {
+    scrollTo(targetRow + rows, true);
+}
+
+void ListView::center(size_t row, bool animate) {
+    size_t count = rowCount();
+    if (count == 0) return;
+    selected = std::min(row, count - 1);
+    scrollTo(static_cast<double>(selected) - (pageRows - 1) / 2, animate);
+}
+
+void ListView::search(const std::string& prefix, bool afterSelection) {
+    query = prefix;
+    size_t count = rowCount();
+    if (query.empty() || count == 0) {
+        searchState = SEARCH_IDLE;
+        return;
+    }
+    size_t start = selected == npos ? 0 : selected + (afterSelection ? 1 : 0);
+    searchNext = start % count;
+    searchLeft = count;
+    searchState = SEARCH_RUNNING;
+}
+
+void ListView::update(float deltaTime) {
+    if (scrollRow != targetRow) {
+        scrollRow += (targetRow - scrollRow) * (1.0 - std::exp(-SCROLL_RATE * deltaTime));
+        if (std::fabs(targetRow - scrollRow) < 0.01) scrollRow = targetRow;
+    }
+
+    if (searchState != SEARCH_RUNNING) return;
+    size_t count = rowCount();
+    size_t budget = std::min(searchLeft, static_cast<size_t>(SEARCH_ROWS_PER_FRAME));
+    for (size_t i = 0; i < budget; i++) {
+        if (startsWith(source->rowName(searchNext), query)) {
+            center(searchNext, true);
+            searchState = SEARCH_FOUND;
+            return;
+        }
+        searchNext = searchNext + 1 == count ? 0 : searchNext + 1;
+    }
+    searchLeft -= budget;
+    if (searchLeft == 0) searchState = SEARCH_NOT_FOUND;
+}
+
+void ListView::render(Engine& engine, const SDL_Rect& area, TTF_Font* font, TTF_Font* highlightFont) {
+    setPageRows(area.h / rowHeight);
+    size_t count = rowCount();
+    if (count == 0) return;
+
+    size_t first = static_cast<size_t>(scrollRow);
+    int offset = static_cast<int>(std::lround((scrollRow - first) * rowHeight));
+    int centerX = area.x + area.w / 2;
+    FixedText<ROW_TEXT_BYTES> text;
+    for (size_t row = first; row < count; row++) {
+        int y = area.y + static_cast<int>(row - first) * rowHeight - offset;
+        if (y >= area.y + area.h) break;
+
+        if (row == selected) {
+            SDL_Rect band = { area.x, y, area.w, rowHeight };
+            SDL_Rect visible;
+            if (SDL_IntersectRect(&band, &area, &visible)) engine.fillRect(visible, SELECTION_COLOR);
+        }
+        text.clear();
+        source->formatRow(row, text);
+        engine.drawText(text.c_str(), centerX, y, TEXT_COLOR, row == highlightRow ? highlightFont : font, true, &area);
+    }
+
+    if (count > static_cast<size_t>(pageRows)) {
+        SDL_Rect track = { area.x + area.w - 4, area.y, 4, area.h };
+        int thumbHeight = std::max(8, static_cast<int>(static_cast<double>(area.h) * pageRows / count));
+        SDL_Rect thumb = { track.x, area.y + static_cast<int>((area.h - thumbHeight) * std::min(1.0, scrollRow / maxScroll())), 4, thumbHeight };
+        engine.fillRect(track, SCROLLBAR_COLOR);
+        engine.fillRect(thumb, THUMB_COLOR);
+    }
+}
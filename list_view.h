@@ -0,0 +1,83 @@
+#ifndef LIST_VIEW_H
+#define LIST_VIEW_H
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <string>
+#include "frame_arena.h"
+
+class Engine;
+
+// Rows a ListView pulls on demand. Only visible rows are ever formatted, so
+// a source can be as large as its backing data.
+class ListSource {
+public:
+    virtual ~ListSource() {}
+    virtual size_t rowCount() const = 0;
+    virtual void formatRow(size_t row, TextBuilder& text) const = 0;
+    // What incremental search matches against, by case-insensitive prefix.
+    virtual const std::string& rowName(size_t row) const = 0;
+};
+
+// Virtualized, smoothly scrolling list. Each frame it formats and draws only
+// the rows inside its viewport, and search scans at most
+// SEARCH_ROWS_PER_FRAME rows per update, so frame time stays flat whether
+// the source has ten rows or ten million.
+class ListView {
+public:
+    static const int SEARCH_ROWS_PER_FRAME = 50000;     // ~1 ms of prefix compares
+    static const int ROW_TEXT_BYTES = 128;
+
+    enum SearchState { SEARCH_IDLE, SEARCH_RUNNING, SEARCH_FOUND, SEARCH_NOT_FOUND };
+
+    ListView();
+
+    // Resets scrolling, selection and search.
+    void setSource(const ListSource* rowSource);
+    void setRowHeight(int height) { rowHeight = height; }
+    void setPageRows(int rows) { pageRows = rows > 0 ? rows : 1; }     // render() also sets it from its area
+    // Rows marked in bold, e.g. the player's own entry; npos for none.
+    void setHighlight(size_t row) { highlightRow = row; }
+
+    size_t selectedRow() const { return selected; }
+    void select(size_t row);                    // and scroll it into view
+    void moveSelection(long long rows);         // clamped to the list
+    void scrollBy(double rows);                 // moves the view, not the selection
+    void center(size_t row, bool animate);      // select row and scroll it to the middle
+
+    // Finds the next row from the selection (or after it) whose name starts
+    // with prefix, over as many updates as it takes.
+    void search(const std::string& prefix, bool afterSelection);
+    void cancelSearch() { searchState = SEARCH_IDLE; }
+    SearchState searchStatus() const { return searchState; }
+
+    void update(float deltaTime);
+    // Draws the rows overlapping area, clipped to it, centered horizontally.
+    void render(Engine& engine, const SDL_Rect& area, TTF_Font* font, TTF_Font* highlightFont);
+
+    int visibleRows() const { return pageRows; }
+    size_t firstVisibleRow() const { return static_cast<size_t>(scrollRow); }
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+private:
+    size_t rowCount() const { return source ? source->rowCount() : 0; }
+    double maxScroll() const;
+    void scrollTo(double row, bool animate);
+    void ensureVisible(size_t row);
+
+    const ListSource* source;
+    int rowHeight;
+    int pageRows;
+    double scrollRow;       // fractional index of the row at the top edge
+    double targetRow;       // where scrollRow is easing to
+    size_t selected;
+    size_t highlightRow;
+
+    std::string query;
+    SearchState searchState;
+    size_t searchNext;      // next row to test
+    size_t searchLeft;      // rows not yet tested
+};
+
+#endif // LIST_VIEW_H
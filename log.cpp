@@ -0,0 +1,393 @@
+#include "log.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<int> Logger::minLevel(LOG_LEVEL_DEBUG);
+
+namespace {
+    const Uint32 PADDING_MARKER = 0xFFFFFFFF;   // argCount of the filler before a wrap
+    const int WRITER_WAKE_MS = 20;
+
+    // Single producer (the owning thread), single consumer (the writer).
+    struct LogRing {
+        alignas(64) std::atomic<size_t> head;   // end of committed records
+        size_t reserved;                        // end of the record being written
+        size_t cachedTail;
+        alignas(64) std::atomic<size_t> tail;   // start of the oldest unread record
+        std::atomic<bool> retired;              // owner thread has exited
+        alignas(64) Uint8 data[Logger::RING_BYTES];
+    };
+
+    // Marks the calling thread's ring for deletion once it has been drained.
+    struct RingOwner {
+        LogRing* ring = nullptr;
+        ~RingOwner() {
+            if (ring) ring->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    thread_local RingOwner owner;
+
+    std::mutex ringMutex;
+    std::vector<LogRing*> rings;
+
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    std::thread writer;
+    bool running = false;
+    bool stopping = false;
+    Uint64 flushRequested = 0;
+    Uint64 flushCompleted = 0;
+    std::string requestedPath;
+    bool pathChanged = false;
+
+    // Writer thread only. Buffers keep their capacity so that steady-state
+    // logging does not show up in the allocation tracker.
+    std::vector<LogRing*> draining;
+    std::FILE* file = nullptr;
+    std::string filePath;
+    size_t fileBytes = 0;
+    std::string line;
+    std::string outBuffer;
+    std::string errBuffer;
+
+    std::atomic<Uint64> writtenCount(0);
+    std::atomic<Uint64> droppedCount(0);
+    std::atomic<Uint64> suppressedCount(0);
+    const Uint64 startTime = static_cast<Uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+
+    const char* levelName(LogLevel level) {
+        switch (level) {
+        case LOG_LEVEL_DEBUG: return "DEBUG";
+        case LOG_LEVEL_INFO: return "INFO ";
+        case LOG_LEVEL_WARN: return "WARN ";
+        default: return "ERROR";
+        }
+    }
+
+    LogRing* createRing() {
+        LogRing* ring = new LogRing();
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->reserved = 0;
+        ring->cachedTail = 0;
+        ring->tail.store(0, std::memory_order_relaxed);
+        ring->retired.store(false, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            rings.push_back(ring);
+        }
+        owner.ring = ring;
+        return ring;
+    }
+
+    void openFile() {
+        file = filePath.empty() ? nullptr : std::fopen(filePath.c_str(), "ab");
+        fileBytes = 0;
+        if (file) {
+            std::fseek(file, 0, SEEK_END);
+            fileBytes = static_cast<size_t>(std::ftell(file));
+        }
+    }
+
+    void writeFile(const std::string& text) {
+        if (!file || text.empty()) return;
+        if (fileBytes >= static_cast<size_t>(Logger::FILE_BYTES)) {
+            std::fclose(file);
+            rotateFiles(filePath, Logger::FILES_KEPT);
+            openFile();
+            if (!file) return;
+        }
+        std::fwrite(text.data(), 1, text.size(), file);
+        fileBytes += text.size();
+    }
+
+    // Appends one record as a line to the buffer for its stream.
+    void formatRecord(const Uint8* record) {
+        Uint32 argCount;
+        LogSite* site;
+        const char* format;
+        Uint64 time;
+        std::memcpy(&argCount, record + 4, sizeof(argCount));
+        std::memcpy(&site, record + 8, sizeof(site));
+        std::memcpy(&format, record + 16, sizeof(format));
+        Uint32 skipped;
+        std::memcpy(&time, record + 24, sizeof(time));
+        std::memcpy(&skipped, record + 32, sizeof(skipped));
+        const Uint8* arg = record + 40;
+
+        char prefix[48];
+        std::snprintf(prefix, sizeof(prefix), "%10.3f %s ", (time - startTime) / 1e9, levelName(site->level));
+        line = prefix;
+
+        Uint32 used = 0;
+        for (const char* c = format; *c; c++) {
+            if (c[0] != '{' || c[1] != '}' || used == argCount) {
+                line += *c;
+                continue;
+            }
+            c++;
+            used++;
+            Uint8 type = *arg++;
+            if (type == Logger::ARG_STRING) {
+                Uint16 length;
+                std::memcpy(&length, arg, sizeof(length));
+                line.append(reinterpret_cast<const char*>(arg + 2), length);
+                arg += 2 + length;
+                continue;
+            }
+            Uint64 bits;
+            std::memcpy(&bits, arg, sizeof(bits));
+            arg += sizeof(bits);
+            char number[32];
+            if (type == Logger::ARG_INT) {
+                std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(bits));
+            }
+            else if (type == Logger::ARG_UINT) {
+                std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(bits));
+            }
+            else if (type == Logger::ARG_DOUBLE) {
+                double value;
+                std::memcpy(&value, &bits, sizeof(value));
+                std::snprintf(number, sizeof(number), "%g", value);
+            }
+            else {
+                std::snprintf(number, sizeof(number), "%s", bits ? "true" : "false");
+            }
+            line += number;
+        }
+
+        if (skipped > 0) {
+            char note[64];
+            std::snprintf(note, sizeof(note), " (%u more suppressed)", skipped);
+            line += note;
+        }
+        if (line.back() != '\n') line += '\n';
+        (site->level >= LOG_LEVEL_WARN ? errBuffer : outBuffer) += line;
+        writtenCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void drainRing(LogRing* ring) {
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        size_t head = ring->head.load(std::memory_order_acquire);
+        while (tail != head) {
+            const Uint8* record = ring->data + (tail & (Logger::RING_BYTES - 1));
+            Uint32 size;
+            Uint32 argCount;
+            std::memcpy(&size, record, sizeof(size));
+            std::memcpy(&argCount, record + 4, sizeof(argCount));
+            if (argCount != PADDING_MARKER) {
+                formatRecord(record);
+            }
+            tail += size;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+
+    // Formats everything committed so far and writes it out.
+    void drainAll() {
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            draining.assign(rings.begin(), rings.end());
+        }
+        for (LogRing* ring : draining) {
+            bool retired = ring->retired.load(std::memory_order_acquire);
+            drainRing(ring);
+            if (retired) {
+                std::lock_guard<std::mutex> lock(ringMutex);
+                rings.erase(std::find(rings.begin(), rings.end(), ring));
+                delete ring;
+            }
+        }
+
+        if (!outBuffer.empty()) {
+            std::fwrite(outBuffer.data(), 1, outBuffer.size(), stdout);
+            std::fflush(stdout);
+            writeFile(outBuffer);
+            outBuffer.clear();
+        }
+        if (!errBuffer.empty()) {
+            std::fwrite(errBuffer.data(), 1, errBuffer.size(), stderr);
+            std::fflush(stderr);
+            writeFile(errBuffer);
+            errBuffer.clear();
+        }
+        if (file) std::fflush(file);
+    }
+
+    void writerLoop() {
+        for (;;) {
+            bool stop;
+            Uint64 flushTarget;
+            {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                wake.wait_for(lock, std::chrono::milliseconds(WRITER_WAKE_MS), [] {
+                    return stopping || pathChanged || flushRequested > flushCompleted;
+                });
+                stop = stopping;
+                flushTarget = flushRequested;
+                if (pathChanged) {
+                    if (file) std::fclose(file);
+                    filePath = requestedPath;
+                    openFile();
+                    pathChanged = false;
+                }
+            }
+
+            drainAll();
+
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                flushCompleted = flushTarget;
+            }
+            flushed.notify_all();
+            if (stop) break;
+        }
+    }
+}
+
+void Logger::start() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (running) return;
+    running = true;
+    stopping = false;
+    writer = std::thread(writerLoop);
+}
+
+void Logger::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (!running) return;
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    running = false;
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    Stats totals = stats();
+    if (totals.dropped > 0 || totals.suppressed > 0) {
+        std::fprintf(stderr, "Log: %llu dropped (ring full), %llu suppressed (rate limit)\n",
+            static_cast<unsigned long long>(totals.dropped), static_cast<unsigned long long>(totals.suppressed));
+    }
+}
+
+void Logger::setFile(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        requestedPath = path;
+        pathChanged = true;
+    }
+    wake.notify_one();
+}
+
+void Logger::setMinLevel(LogLevel level) {
+    minLevel.store(level, std::memory_order_relaxed);
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    if (!running) return;
+    Uint64 target = ++flushRequested;
+    wake.notify_one();
+    flushed.wait(lock, [target] { return flushCompleted >= target || !running; });
+}
+
+Logger::Stats Logger::stats() {
+    Stats result;
+    result.written = writtenCount.load(std::memory_order_relaxed);
+    result.dropped = droppedCount.load(std::memory_order_relaxed);
+    result.suppressed = suppressedCount.load(std::memory_order_relaxed);
+    return result;
+}
+
+Uint64 Logger::timestamp() {
+    return static_cast<Uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Allows SITE_RATE messages per site in each ~1 s window (2^30 ns). Sites
+// shared between threads count approximately; that is fine for a limit.
+bool Logger::admit(LogSite& site, Uint64 now) {
+    Uint32 window = static_cast<Uint32>(now >> 30);
+    Uint32 count = 0;
+    if (site.window.load(std::memory_order_relaxed) != window) {
+        site.window.store(window, std::memory_order_relaxed);
+    }
+    else {
+        count = site.windowCount.load(std::memory_order_relaxed);
+    }
+    if (count >= static_cast<Uint32>(SITE_RATE)) {
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        suppressedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    site.windowCount.store(count + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Uint8* Logger::reserve(size_t& size) {
+    LogRing* ring = owner.ring ? owner.ring : createRing();
+    size = (size + 7) & ~static_cast<size_t>(7);
+
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t offset = head & (RING_BYTES - 1);
+    size_t toEnd = RING_BYTES - offset;
+    // A record never wraps: if it does not fit before the end, filler covers
+    // the rest and the record starts at offset 0.
+    size_t needed = size <= toEnd ? size : toEnd + size;
+    if (head + needed - ring->cachedTail > static_cast<size_t>(RING_BYTES)) {
+        ring->cachedTail = ring->tail.load(std::memory_order_acquire);
+        if (head + needed - ring->cachedTail > static_cast<size_t>(RING_BYTES)) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+
+    if (size > toEnd) {
+        Uint32 fill = static_cast<Uint32>(toEnd);
+        std::memcpy(ring->data + offset, &fill, sizeof(fill));
+        std::memcpy(ring->data + offset + 4, &PADDING_MARKER, sizeof(PADDING_MARKER));
+        offset = 0;
+    }
+    ring->reserved = head + needed;
+    return ring->data + offset;
+}
+
+void Logger::commit() {
+    LogRing* ring = owner.ring;
+    ring->head.store(ring->reserved, std::memory_order_release);
+}
+
+void Logger::writeHeader(Uint8* out, LogSite& site, const char* format, Uint64 now, Uint32 size, Uint32 argCount) {
+    LogSite* sitePointer = &site;
+    // Only touch the shared counter when there is something to take.
+    Uint32 skipped = site.suppressed.load(std::memory_order_relaxed) ? site.suppressed.exchange(0, std::memory_order_relaxed) : 0;
+    size = (size + 7) & ~7u;
+    std::memcpy(out, &size, sizeof(size));
+    std::memcpy(out + 4, &argCount, sizeof(argCount));
+    std::memset(out + 8, 0, 16);
+    std::memcpy(out + 8, &sitePointer, sizeof(sitePointer));
+    std::memcpy(out + 16, &format, sizeof(format));
+    std::memcpy(out + 24, &now, sizeof(now));
+    std::memcpy(out + 32, &skipped, sizeof(skipped));
+    std::memset(out + 36, 0, 4);
+}
+
+void rotateFiles(const std::string& path, int kept) {
+    std::remove((path + "." + std::to_string(kept)).c_str());
+    for (int i = kept - 1; i >= 1; i--) {
+        std::rename((path + "." + std::to_string(i)).c_str(), (path + "." + std::to_string(i + 1)).c_str());
+    }
+    std::rename(path.c_str(), (path + ".1").c_str());
+}
@@ -0,0 +1,223 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <SDL.h>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// Asynchronous logging. A log call copies its format string pointer and raw
+// arguments into a lock-free ring buffer owned by the calling thread;
+// a background thread formats the records and writes them to the console and
+// an optional rotating file. Nothing on the calling thread blocks, flushes or
+// allocates (after a thread's first call). When a ring is full the record is
+// dropped and counted.
+//
+//     LOG_INFO("World opened: {}x{} cells", size, size);
+//
+// Formats must be string literals; each {} takes the next argument. Arguments
+// can be integers, floating point, bool, const char* or std::string (strings
+// are copied, up to Logger::MAX_STRING bytes).
+//
+// LOG_MIN_LEVEL removes calls below it at compile time: 0 keeps debug
+// messages, 1 info and up (the default in release builds), 2 warnings and
+// errors, 3 errors only.
+enum LogLevel {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+};
+
+#ifndef LOG_MIN_LEVEL
+#ifdef _DEBUG
+#define LOG_MIN_LEVEL 0
+#else
+#define LOG_MIN_LEVEL 1
+#endif
+#endif
+
+// One per call site. Each site may log SITE_RATE messages per second;
+// the rest are counted and reported with the next message that gets through.
+struct LogSite {
+    LogSite(LogLevel level, const char* file, int line)
+        : level(level), file(file), line(line), window(0), windowCount(0), suppressed(0) {}
+
+    const LogLevel level;
+    const char* const file;
+    const int line;
+    std::atomic<Uint32> window;
+    std::atomic<Uint32> windowCount;
+    std::atomic<Uint32> suppressed;
+};
+
+class Logger {
+public:
+    static const int RING_BYTES = 64 * 1024;        // per thread
+    static const int SITE_RATE = 50;                // messages per site per second
+    static const int MAX_STRING = 4096;             // longer strings are cut
+    static const int FILE_BYTES = 4 * 1024 * 1024;
+    static const int FILES_KEPT = 3;                // file.1 .. file.3
+
+    enum ArgType : Uint8 { ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_BOOL, ARG_STRING };
+
+    struct Stats {
+        Uint64 written;
+        Uint64 dropped;         // ring full
+        Uint64 suppressed;      // over the per-site rate
+    };
+
+    static void start();
+    static void stop();                             // drains everything first
+
+    // Also write to path, rotating at FILE_BYTES. Empty closes the file.
+    static void setFile(const std::string& path);
+    static void setMinLevel(LogLevel level);        // runtime filter on top of LOG_MIN_LEVEL
+
+    // Blocks until everything logged so far on any thread is written.
+    static void flush();
+    static Stats stats();
+
+    template <typename... Args>
+    static void write(LogSite& site, const char* format, const Args&... args) {
+        if (site.level < minLevel.load(std::memory_order_relaxed)) return;
+        Uint64 now = timestamp();
+        if (!admit(site, now)) return;
+
+        size_t size = RECORD_HEADER_BYTES + (argSize(args) + ... + 0);
+        Uint8* out = reserve(size);
+        if (!out) return;
+        writeHeader(out, site, format, now, static_cast<Uint32>(size), static_cast<Uint32>(sizeof...(Args)));
+        out += RECORD_HEADER_BYTES;
+        (writeArg(out, args), ...);
+        commit();
+    }
+
+private:
+    // size, argCount, site, format, timestamp, messages suppressed before this one
+    static const size_t RECORD_HEADER_BYTES = 40;
+
+    static Uint64 timestamp();
+    static bool admit(LogSite& site, Uint64 now);
+    static Uint8* reserve(size_t& size);            // rounds size up; null when full
+    static void commit();
+    static void writeHeader(Uint8* out, LogSite& site, const char* format, Uint64 now, Uint32 size, Uint32 argCount);
+
+    // Type tag, then 8 bytes for a number or a 2-byte length and the bytes
+    // for a string.
+    template <typename T>
+    static size_t argSize(const T& value) {
+        if constexpr (std::is_same<T, std::string>::value) {
+            return 1 + 2 + clampedLength(value.size());
+        }
+        else if constexpr (std::is_convertible<const T&, const char*>::value) {
+            const char* text = value;
+            return 1 + 2 + clampedLength(text ? std::strlen(text) : 0);
+        }
+        else {
+            static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                "log arguments are numbers, enums, bool, const char* or std::string");
+            return 1 + 8;
+        }
+    }
+
+    template <typename T>
+    static void writeArg(Uint8*& out, const T& value) {
+        if constexpr (std::is_same<T, std::string>::value) {
+            writeString(out, value.data(), value.size());
+        }
+        else if constexpr (std::is_convertible<const T&, const char*>::value) {
+            const char* text = value;
+            writeString(out, text ? text : "", text ? std::strlen(text) : 0);
+        }
+        else {
+            writeNumber(out, value);
+        }
+    }
+
+    template <typename T>
+    static void writeNumber(Uint8*& out, const T& value) {
+        Uint8 type;
+        Uint64 bits;
+        if constexpr (std::is_enum<T>::value) {
+            type = ARG_INT;
+            bits = static_cast<Uint64>(static_cast<Sint64>(value));
+        }
+        else if constexpr (std::is_same<T, bool>::value) {
+            type = ARG_BOOL;
+            bits = value ? 1 : 0;
+        }
+        else if constexpr (std::is_floating_point<T>::value) {
+            type = ARG_DOUBLE;
+            double converted = static_cast<double>(value);
+            std::memcpy(&bits, &converted, sizeof(bits));
+        }
+        else if constexpr (std::is_signed<T>::value) {
+            type = ARG_INT;
+            bits = static_cast<Uint64>(static_cast<Sint64>(value));
+        }
+        else {
+            type = ARG_UINT;
+            bits = static_cast<Uint64>(value);
+        }
+        *out++ = type;
+        std::memcpy(out, &bits, sizeof(bits));
+        out += sizeof(bits);
+    }
+
+    static size_t clampedLength(size_t length) { return length < static_cast<size_t>(MAX_STRING) ? length : MAX_STRING; }
+
+    static void writeString(Uint8*& out, const char* text, size_t length) {
+        length = clampedLength(length);
+        Uint16 stored = static_cast<Uint16>(length);
+        *out++ = ARG_STRING;
+        std::memcpy(out, &stored, sizeof(stored));
+        out += sizeof(stored);
+        std::memcpy(out, text, length);
+        out += length;
+    }
+
+    static std::atomic<int> minLevel;
+};
+
+// Starts the logger for the lifetime of a scope, normally main().
+class LogSession {
+public:
+    LogSession() { Logger::start(); }
+    ~LogSession() { Logger::stop(); }
+
+    LogSession(const LogSession&) = delete;
+    LogSession& operator=(const LogSession&) = delete;
+};
+
+// Moves path to path.1, path.1 to path.2 and so on, dropping path.kept.
+void rotateFiles(const std::string& path, int kept);
+
+#define LOG_AT(level, ...) \
+    do { \
+        static LogSite logSite(level, __FILE__, __LINE__); \
+        Logger::write(logSite, __VA_ARGS__); \
+    } while (0)
+
+#if LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= 1
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= 2
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif // LOG_H
@@ -1,8 +1,124 @@
 #include "Engine.h"
+#include "alloc_tracker.h"
+#include "game_schema.h"
+#include "log.h"
+#include <cstdlib>
+#include <cstring>
+
+static EngineOptions parseOptions(int argc, char* argv[]) {
+    EngineOptions options;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--headless") == 0) {
+            options.headless = true;
+        }
+        else if (std::strcmp(arg, "--frames") == 0 && hasValue) {
+            options.frameLimit = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--alloc-budget") == 0 && hasValue) {
+            options.allocBudget = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(arg, "--alloc-byte-budget") == 0 && hasValue) {
+            options.allocByteBudget = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(arg, "--alloc-warmup") == 0 && hasValue) {
+            options.allocWarmupFrames = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--audio-driver") == 0 && hasValue) {
+            options.audioDriver = argv[++i];
+        }
+        else if (std::strcmp(arg, "--audio-low-latency") == 0) {
+            options.audioLowLatency = true;
+        }
+        else if (std::strcmp(arg, "--latency") == 0) {
+            options.latencyMode = true;
+        }
+        else if (std::strcmp(arg, "--inject-input") == 0 && hasValue) {
+            options.injectInputMs = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--latency-out") == 0 && hasValue) {
+            options.latencyOut = argv[++i];
+            options.latencyMode = true;
+        }
+        else if (std::strcmp(arg, "--frame-budget") == 0 && hasValue) {
+            options.frameBudgetMs = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--stress") == 0) {
+            options.stress = true;
+        }
+        else if (std::strcmp(arg, "--soft-raster") == 0) {
+            options.softRaster = true;
+        }
+        else if (std::strcmp(arg, "--raster-threads") == 0 && hasValue) {
+            options.rasterThreads = std::atoi(argv[++i]);
+            options.softRaster = true;
+        }
+        else if (std::strcmp(arg, "--spectate") == 0 && hasValue) {
+            options.spectatorPort = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--spectator-bench") == 0 && hasValue) {
+            options.spectatorBench = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--metrics-port") == 0 && hasValue) {
+            options.metricsPort = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--metrics-file") == 0 && hasValue) {
+            options.metricsFile = argv[++i];
+        }
+        else if (std::strcmp(arg, "--serializer-bench") == 0) {
+            options.serializerBench = true;
+        }
+        else if (std::strcmp(arg, "--log-file") == 0 && hasValue) {
+            options.logFile = argv[++i];
+        }
+        else if (std::strcmp(arg, "--capture") == 0 && hasValue) {
+            options.capturePath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--capture-extract") == 0 && hasValue) {
+            options.captureExtract = argv[++i];
+        }
+        else if (std::strcmp(arg, "--stall-ms") == 0 && hasValue) {
+            options.stallThresholdMs = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--stall-report") == 0 && hasValue) {
+            options.stallReport = argv[++i];
+        }
+        else {
+            LOG_WARN("Unknown option: {}", arg);
+        }
+    }
+    return options;
+}
 
 int main(int argc, char* argv[]) {
+    // SDL bellek fonksiyonlarn SDL_Init'ten nce bala
+    AllocTracker::installSDLHooks();
+
+    // Gnlk yazcs: mesajlar arka plan i paracnda yazar, main bitince boaltr
+    LogSession logging;
+
+    EngineOptions options = parseOptions(argc, argv);
+    if (!options.logFile.empty()) {
+        Logger::setFile(options.logFile);
+    }
+
+    // Seyirci yk testi: pencere amadan yalnzca yayn sunucusunu l
+    if (options.spectatorBench > 0) {
+        return runSpectatorBenchmark(options.spectatorBench);
+    }
+    // Seriletirici hz testi: GB/s l ve k
+    if (options.serializerBench) {
+        return runSerializerBenchmark();
+    }
+    // Kayt dosyasndaki kareleri BMP olarak da aktar ve k
+    if (!options.captureExtract.empty()) {
+        return extractCapture(options.captureExtract);
+    }
+
     // Engine snfndan bir nesne olutur
     Engine engine;
+    engine.configure(options);
 
     // Oyun motorunu balat
     if (engine.initialize()) {
@@ -10,5 +126,5 @@ int main(int argc, char* argv[]) {
         engine.run();
     }
 
-    return 0;
+    return engine.getExitCode();
 }
\ No newline at end of file
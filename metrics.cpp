@@ -0,0 +1,272 @@
+#include "metrics.h"
+#include "log.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+    const int ACCEPT_WAIT_MS = 100;
+    const int CLIENT_TIMEOUT_MS = 1000;
+    const size_t MAX_REQUEST_BYTES = 4096;
+
+    void appendNumber(std::string& out, double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        out += buffer;
+    }
+
+    void appendCount(std::string& out, Uint64 value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value));
+        out += buffer;
+    }
+
+    void appendHeader(std::string& out, const char* name, const char* help, const char* type) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    // Keeps sending until everything is out, the peer goes away or the
+    // deadline passes.
+    bool sendAll(NetSocket socket, const char* data, size_t size) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CLIENT_TIMEOUT_MS);
+        while (size > 0) {
+            NetSlice slice = { reinterpret_cast<const Uint8*>(data), size };
+            long sent = netSend(socket, &slice, 1);
+            if (sent < 0) return false;
+            if (sent == 0) {
+                if (std::chrono::steady_clock::now() > deadline) return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+}
+
+MetricHistogram::MetricHistogram(std::initializer_list<double> upperBounds)
+    : bounds(0),
+    total(0.0) {
+    for (double value : upperBounds) {
+        if (bounds == MAX_BOUNDS) break;
+        upper[bounds++] = value;
+    }
+    for (auto& count : counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void MetricHistogram::observe(double amount) {
+    int index = 0;
+    while (index < bounds && amount > upper[index]) {
+        index++;
+    }
+    counts[index].store(counts[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    total.store(total.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::add(const char* name, const char* help, const MetricCounter& counter) {
+    entries.push_back({ name, help, COUNTER, &counter });
+}
+
+void MetricsRegistry::add(const char* name, const char* help, const MetricGauge& gauge) {
+    entries.push_back({ name, help, GAUGE, &gauge });
+}
+
+void MetricsRegistry::add(const char* name, const char* help, const MetricHistogram& histogram) {
+    entries.push_back({ name, help, HISTOGRAM, &histogram });
+}
+
+void MetricsRegistry::writePrometheus(std::string& out) const {
+    for (const Entry& entry : entries) {
+        if (entry.type == COUNTER) {
+            appendHeader(out, entry.name, entry.help, "counter");
+            out += entry.name;
+            out += ' ';
+            appendCount(out, static_cast<const MetricCounter*>(entry.metric)->get());
+            out += '\n';
+        }
+        else if (entry.type == GAUGE) {
+            appendHeader(out, entry.name, entry.help, "gauge");
+            out += entry.name;
+            out += ' ';
+            appendNumber(out, static_cast<const MetricGauge*>(entry.metric)->get());
+            out += '\n';
+        }
+        else {
+            const MetricHistogram& histogram = *static_cast<const MetricHistogram*>(entry.metric);
+            appendHeader(out, entry.name, entry.help, "histogram");
+            Uint64 cumulative = 0;
+            for (int i = 0; i <= histogram.boundCount(); i++) {
+                cumulative += histogram.bucket(i);
+                out += entry.name;
+                out += "_bucket{le=\"";
+                if (i < histogram.boundCount()) {
+                    appendNumber(out, histogram.bound(i));
+                }
+                else {
+                    out += "+Inf";
+                }
+                out += "\"} ";
+                appendCount(out, cumulative);
+                out += '\n';
+            }
+            out += entry.name;
+            out += "_sum ";
+            appendNumber(out, histogram.sum());
+            out += '\n';
+            out += entry.name;
+            out += "_count ";
+            appendCount(out, cumulative);
+            out += '\n';
+        }
+    }
+}
+
+MetricsExporter::MetricsExporter()
+    : registry(nullptr),
+    listener(NO_SOCKET),
+    boundPort(0),
+    snapshotIntervalMs(0),
+    snapshotBytes(0),
+    stopping(false) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+bool MetricsExporter::start(const MetricsRegistry& metricsRegistry, Uint16 httpPort, const std::string& file, int intervalMs) {
+    if (isRunning()) return true;
+    if (httpPort == 0 && file.empty()) return false;
+
+    registry = &metricsRegistry;
+    if (httpPort != 0) {
+        if (!netStartup()) {
+            LOG_ERROR("Metrics: socket library could not start");
+            return false;
+        }
+        // Localhost only: the endpoint has no authentication.
+        listener = netListen(httpPort, true, boundPort);
+        if (listener == NO_SOCKET) {
+            LOG_ERROR("Metrics: could not listen on port {}", httpPort);
+            netShutdown();
+            return false;
+        }
+        LOG_INFO("Metrics at http://127.0.0.1:{}/metrics", boundPort);
+    }
+
+    snapshotFile = file;
+    snapshotIntervalMs = intervalMs > 0 ? intervalMs : 10000;
+    snapshotBytes = 0;
+    if (!snapshotFile.empty()) {
+        std::ifstream existing(snapshotFile, std::ios::binary | std::ios::ate);
+        if (existing.is_open()) {
+            snapshotBytes = static_cast<size_t>(existing.tellg());
+        }
+    }
+
+    stopping = false;
+    worker = std::thread(&MetricsExporter::exportLoop, this);
+    return true;
+}
+
+void MetricsExporter::stop() {
+    if (!isRunning()) return;
+    stopping = true;
+    worker.join();
+
+    // One last snapshot so the file ends with the final values.
+    if (!snapshotFile.empty()) {
+        writeSnapshot();
+    }
+    if (listener != NO_SOCKET) {
+        netClose(listener);
+        listener = NO_SOCKET;
+        netShutdown();
+    }
+}
+
+void MetricsExporter::exportLoop() {
+    auto nextSnapshot = std::chrono::steady_clock::now() + std::chrono::milliseconds(snapshotIntervalMs);
+    while (!stopping) {
+        if (listener != NO_SOCKET) {
+            if (netWaitReadable(listener, ACCEPT_WAIT_MS)) {
+                NetSocket client;
+                while ((client = netAccept(listener)) != NO_SOCKET) {
+                    serveClient(client);
+                    netClose(client);
+                }
+            }
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ACCEPT_WAIT_MS));
+        }
+
+        if (!snapshotFile.empty() && std::chrono::steady_clock::now() >= nextSnapshot) {
+            writeSnapshot();
+            nextSnapshot += std::chrono::milliseconds(snapshotIntervalMs);
+        }
+    }
+}
+
+// Minimal HTTP/1.0: reads the request head, answers, and closes.
+void MetricsExporter::serveClient(NetSocket client) {
+    std::string request;
+    Uint8 buffer[1024];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CLIENT_TIMEOUT_MS);
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_BYTES) {
+        long got = netReceive(client, buffer, sizeof(buffer));
+        if (got < 0) return;
+        if (got == 0) {
+            if (std::chrono::steady_clock::now() > deadline) return;
+            netWaitReadable(client, 10);
+            continue;
+        }
+        request.append(reinterpret_cast<const char*>(buffer), static_cast<size_t>(got));
+    }
+
+    bool wanted = request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0;
+    text.clear();
+    if (wanted) {
+        registry->writePrometheus(text);
+    }
+    else {
+        text = "Not found; metrics are at /metrics\n";
+    }
+
+    char head[160];
+    int headSize = std::snprintf(head, sizeof(head),
+        "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+        wanted ? "200 OK" : "404 Not Found", static_cast<unsigned>(text.size()));
+    if (sendAll(client, head, static_cast<size_t>(headSize))) {
+        sendAll(client, text.data(), text.size());
+    }
+}
+
+void MetricsExporter::writeSnapshot() {
+    if (snapshotBytes >= static_cast<size_t>(SNAPSHOT_FILE_BYTES)) {
+        rotateFiles(snapshotFile, SNAPSHOT_FILES_KEPT);
+        snapshotBytes = 0;
+    }
+
+    text = "# snapshot at unix time ";
+    appendCount(text, static_cast<Uint64>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count()));
+    text += '\n';
+    registry->writePrometheus(text);
+
+    std::ofstream file(snapshotFile, std::ios::binary | std::ios::app);
+    if (!file.is_open()) return;
+    file << text;
+    snapshotBytes += text.size();
+}
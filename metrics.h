@@ -0,0 +1,121 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <SDL.h>
+#include <atomic>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <vector>
+#include "net_socket.h"
+
+// Runtime metrics. Each metric has a single writer thread, which lets
+// recording be plain relaxed loads and stores instead of locked
+// read-modify-writes: a few nanoseconds, cheap enough for the frame loop.
+// Any thread may read. Readers see each value on its own, not a consistent
+// snapshot across metrics.
+class MetricCounter {
+public:
+    MetricCounter() : value(0) {}
+
+    void add(Uint64 amount = 1) { value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed); }
+    Uint64 get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<Uint64> value;
+};
+
+class MetricGauge {
+public:
+    MetricGauge() : value(0.0) {}
+
+    void set(double amount) { value.store(amount, std::memory_order_relaxed); }
+    double get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value;
+};
+
+// Counts observations into fixed buckets, given as ascending upper bounds.
+// Values above the last bound land in an overflow bucket.
+class MetricHistogram {
+public:
+    static const int MAX_BOUNDS = 15;
+
+    MetricHistogram(std::initializer_list<double> upperBounds);
+
+    void observe(double amount);
+
+    int boundCount() const { return bounds; }
+    double bound(int index) const { return upper[index]; }
+    Uint64 bucket(int index) const { return counts[index].load(std::memory_order_relaxed); }   // not cumulative
+    double sum() const { return total.load(std::memory_order_relaxed); }
+
+private:
+    double upper[MAX_BOUNDS];
+    int bounds;
+    std::atomic<Uint64> counts[MAX_BOUNDS + 1];
+    std::atomic<double> total;
+};
+
+// Names the metrics for export. Register everything before the exporter
+// starts; the list is read without locking afterwards.
+class MetricsRegistry {
+public:
+    void add(const char* name, const char* help, const MetricCounter& counter);
+    void add(const char* name, const char* help, const MetricGauge& gauge);
+    void add(const char* name, const char* help, const MetricHistogram& histogram);
+
+    // Prometheus text exposition format, version 0.0.4.
+    void writePrometheus(std::string& out) const;
+
+private:
+    enum MetricType { COUNTER, GAUGE, HISTOGRAM };
+
+    struct Entry {
+        const char* name;
+        const char* help;
+        MetricType type;
+        const void* metric;
+    };
+
+    std::vector<Entry> entries;
+};
+
+// Serves GET /metrics on a localhost port and/or appends the same text to a
+// file every few seconds, rotating it when it gets large. Runs on its own
+// thread so a slow scraper never touches the frame loop.
+class MetricsExporter {
+public:
+    static const int SNAPSHOT_FILE_BYTES = 1024 * 1024;   // rotate after this
+    static const int SNAPSHOT_FILES_KEPT = 3;             // file.1 .. file.3
+
+    MetricsExporter();
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // httpPort 0 skips the endpoint, an empty file name the snapshots.
+    bool start(const MetricsRegistry& registry, Uint16 httpPort, const std::string& snapshotFile, int snapshotIntervalMs);
+    void stop();
+    bool isRunning() const { return worker.joinable(); }
+    Uint16 port() const { return boundPort; }
+
+private:
+    void exportLoop();
+    void serveClient(NetSocket client);
+    void writeSnapshot();
+
+    const MetricsRegistry* registry;
+    NetSocket listener;
+    Uint16 boundPort;
+    std::string snapshotFile;
+    int snapshotIntervalMs;
+    size_t snapshotBytes;
+    std::string text;
+    std::thread worker;
+    std::atomic<bool> stopping;
+};
+
+#endif // METRICS_H
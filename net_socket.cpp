@@ -0,0 +1,179 @@
+#include "net_socket.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    typedef SOCKET SocketHandle;
+
+    bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+
+    bool setNonBlocking(SocketHandle s) {
+        u_long mode = 1;
+        return ioctlsocket(s, FIONBIO, &mode) == 0;
+    }
+#else
+    typedef int SocketHandle;
+
+#ifdef MSG_NOSIGNAL
+    const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    const int SEND_FLAGS = 0;   // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+    bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+
+    bool setNonBlocking(SocketHandle s) {
+        int flags = fcntl(s, F_GETFL, 0);
+        return flags != -1 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+#endif
+
+    SocketHandle handle(NetSocket socket) { return static_cast<SocketHandle>(socket); }
+
+    void configureStream(SocketHandle s) {
+        int one = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+#ifdef SO_NOSIGPIPE
+        setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    }
+
+    sockaddr_in loopbackAddress(Uint16 port) {
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return address;
+    }
+}
+
+bool netStartup() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+void netShutdown() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+NetSocket netListen(Uint16 port, bool loopbackOnly, Uint16& boundPort) {
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (static_cast<NetSocket>(s) == NO_SOCKET) return NO_SOCKET;
+
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+
+    sockaddr_in address = loopbackAddress(port);
+    if (!loopbackOnly) address.sin_addr.s_addr = htonl(INADDR_ANY);
+    socklen_t addressSize = sizeof(address);
+    if (bind(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(s, SOMAXCONN) != 0 ||
+        !setNonBlocking(s) || getsockname(s, reinterpret_cast<sockaddr*>(&address), &addressSize) != 0) {
+        netClose(static_cast<NetSocket>(s));
+        return NO_SOCKET;
+    }
+    boundPort = ntohs(address.sin_port);
+    return static_cast<NetSocket>(s);
+}
+
+NetSocket netAccept(NetSocket listener) {
+    for (;;) {
+        SocketHandle s = accept(handle(listener), nullptr, nullptr);
+        if (static_cast<NetSocket>(s) == NO_SOCKET) return NO_SOCKET;
+        if (setNonBlocking(s)) {
+            configureStream(s);
+            return static_cast<NetSocket>(s);
+        }
+        netClose(static_cast<NetSocket>(s));
+    }
+}
+
+NetSocket netConnectLoopback(Uint16 port) {
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (static_cast<NetSocket>(s) == NO_SOCKET) return NO_SOCKET;
+
+    sockaddr_in address = loopbackAddress(port);
+    if (connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || !setNonBlocking(s)) {
+        netClose(static_cast<NetSocket>(s));
+        return NO_SOCKET;
+    }
+    configureStream(s);
+    return static_cast<NetSocket>(s);
+}
+
+void netClose(NetSocket socket) {
+#ifdef _WIN32
+    closesocket(handle(socket));
+#else
+    close(handle(socket));
+#endif
+}
+
+bool netWaitReadable(NetSocket socket, int timeoutMs) {
+#ifdef _WIN32
+    WSAPOLLFD entry = { handle(socket), POLLRDNORM, 0 };
+    return WSAPoll(&entry, 1, timeoutMs) > 0;
+#else
+    pollfd entry = { handle(socket), POLLIN, 0 };
+    return poll(&entry, 1, timeoutMs) > 0;
+#endif
+}
+
+long netSend(NetSocket socket, const NetSlice* slices, int count) {
+    if (count > NET_MAX_SLICES) count = NET_MAX_SLICES;
+#ifdef _WIN32
+    WSABUF buffers[NET_MAX_SLICES];
+    for (int i = 0; i < count; i++) {
+        buffers[i].buf = reinterpret_cast<CHAR*>(const_cast<Uint8*>(slices[i].data));
+        buffers[i].len = static_cast<ULONG>(slices[i].size);
+    }
+    DWORD sent = 0;
+    if (WSASend(handle(socket), buffers, count, &sent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+        return wouldBlock() ? 0 : -1;
+    }
+    return static_cast<long>(sent);
+#else
+    iovec buffers[NET_MAX_SLICES];
+    for (int i = 0; i < count; i++) {
+        buffers[i].iov_base = const_cast<Uint8*>(slices[i].data);
+        buffers[i].iov_len = slices[i].size;
+    }
+    msghdr message = {};
+    message.msg_iov = buffers;
+    message.msg_iovlen = count;
+    ssize_t sent = sendmsg(handle(socket), &message, SEND_FLAGS);
+    if (sent < 0) return wouldBlock() ? 0 : -1;
+    return static_cast<long>(sent);
+#endif
+}
+
+long netReceive(NetSocket socket, Uint8* buffer, size_t size) {
+#ifdef _WIN32
+    int got = recv(handle(socket), reinterpret_cast<char*>(buffer), static_cast<int>(size), 0);
+    if (got == SOCKET_ERROR) return wouldBlock() ? 0 : -1;
+#else
+    ssize_t got = recv(handle(socket), buffer, size, 0);
+    if (got < 0) return wouldBlock() ? 0 : -1;
+#endif
+    return got == 0 ? -1 : static_cast<long>(got);
+}
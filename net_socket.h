@@ -0,0 +1,41 @@
+#ifndef NET_SOCKET_H
+#define NET_SOCKET_H
+
+#include <SDL.h>
+#include <cstddef>
+#include <cstdint>
+
+// Small portable layer over Winsock and BSD sockets for the TCP servers.
+// Sockets are passed around as NetSocket so headers do not pull in the
+// platform socket headers. Every socket returned here is non-blocking.
+typedef uintptr_t NetSocket;
+const NetSocket NO_SOCKET = ~static_cast<NetSocket>(0);
+
+// One piece of a gathered send.
+struct NetSlice {
+    const Uint8* data;
+    size_t size;
+};
+
+static const int NET_MAX_SLICES = 128;
+
+// Each successful netStartup() needs a matching netShutdown().
+bool netStartup();
+void netShutdown();
+
+// Port 0 picks a free port, reported in boundPort. NO_SOCKET on failure.
+NetSocket netListen(Uint16 port, bool loopbackOnly, Uint16& boundPort);
+NetSocket netAccept(NetSocket listener);    // NO_SOCKET when nobody is waiting
+NetSocket netConnectLoopback(Uint16 port);
+void netClose(NetSocket socket);
+
+// Waits up to timeoutMs for the socket to become readable (or, for a
+// listener, for a connection to arrive).
+bool netWaitReadable(NetSocket socket, int timeoutMs);
+
+// Bytes transferred, 0 if the call would block, -1 if the connection is
+// closed or broken. netSend takes at most NET_MAX_SLICES slices.
+long netSend(NetSocket socket, const NetSlice* slices, int count);
+long netReceive(NetSocket socket, Uint8* buffer, size_t size);
+
+#endif // NET_SOCKET_H
@@ -0,0 +1,50 @@
+#ifndef PROFILE_ZONE_H
+#define PROFILE_ZONE_H
+
+#include <atomic>
+
+// Names the region of code currently running on this thread. Zones nest, and
+// instrumentation (allocation tracking, stall reports) attributes its samples
+// to the innermost one. Names must be string literals.
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : parent(currentName) { enter(name); }
+    ~ProfileZone() { enter(parent); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+    static const char* current() { return currentName ? currentName : "(no zone)"; }
+
+    // Mirrors the calling thread's zone where other threads can read it; the
+    // stall watchdog uses it for the main thread. One thread at a time.
+    static void publishThisThread() {
+        publishing = true;
+        publishedName.store(currentName, std::memory_order_relaxed);
+    }
+    static const char* published() {
+        const char* name = publishedName.load(std::memory_order_relaxed);
+        return name ? name : "(no zone)";
+    }
+
+private:
+    static void enter(const char* name) {
+        currentName = name;
+        if (publishing) publishedName.store(name, std::memory_order_relaxed);
+    }
+
+    const char* parent;
+    static thread_local const char* currentName;
+    static thread_local bool publishing;
+    static std::atomic<const char*> publishedName;
+};
+
+inline thread_local const char* ProfileZone::currentName = nullptr;
+inline thread_local bool ProfileZone::publishing = false;
+inline std::atomic<const char*> ProfileZone::publishedName{ nullptr };
+
+#define PROFILE_ZONE_JOIN2(a, b) a##b
+#define PROFILE_ZONE_JOIN(a, b) PROFILE_ZONE_JOIN2(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_JOIN(profileZone, __LINE__)(name)
+
+#endif // PROFILE_ZONE_H
@@ -0,0 +1,99 @@
+#include "quality_governor.h"
+#include <algorithm>
+
+namespace {
+    const QualitySettings LEVEL_SETTINGS[QUALITY_LEVEL_COUNT] = {
+        { 20000, 5000, true, false, 1 },
+        { 5000, 1000, true, false, 2 },
+        { 1000, 200, false, false, 6 },
+        { 200, 50, false, true, 15 },
+    };
+
+    const double SMOOTHING = 0.1;         // weight of the newest frame
+    const double UPGRADE_RATIO = 0.6;     // step up only when well under budget
+    const int DEGRADE_HOLD_FRAMES = 15;
+    const int UPGRADE_HOLD_FRAMES = 90;
+    const int COOLDOWN_FRAMES = 30;       // let the average settle after a change
+}
+
+QualityGovernor::QualityGovernor()
+    : budgetMs(0.0),
+    smoothed(0.0),
+    currentLevel(QUALITY_HIGH),
+    overFrames(0),
+    underFrames(0),
+    cooldownFrames(0),
+    framesSeen(0),
+    framesOver(0),
+    framesAtLevel(),
+    levelChanges(0),
+    worstSmoothed(0.0) {
+}
+
+void QualityGovernor::setBudget(double ms) {
+    budgetMs = std::max(0.0, ms);
+    if (budgetMs == 0.0) currentLevel = QUALITY_HIGH;
+}
+
+void QualityGovernor::onFrame(double frameMs) {
+    smoothed = smoothed == 0.0 ? frameMs : smoothed + (frameMs - smoothed) * SMOOTHING;
+
+    framesSeen++;
+    framesAtLevel[currentLevel]++;
+    worstSmoothed = std::max(worstSmoothed, smoothed);
+    if (budgetMs <= 0.0) return;
+    if (smoothed > budgetMs) framesOver++;
+
+    if (cooldownFrames > 0) {
+        cooldownFrames--;
+        return;
+    }
+
+    overFrames = smoothed > budgetMs ? overFrames + 1 : 0;
+    underFrames = smoothed < budgetMs * UPGRADE_RATIO ? underFrames + 1 : 0;
+
+    if (overFrames >= DEGRADE_HOLD_FRAMES && currentLevel < QUALITY_MINIMAL) {
+        changeLevel(1);
+    }
+    else if (underFrames >= UPGRADE_HOLD_FRAMES && currentLevel > QUALITY_HIGH) {
+        changeLevel(-1);
+    }
+}
+
+const QualitySettings& QualityGovernor::settings() const {
+    return LEVEL_SETTINGS[currentLevel];
+}
+
+void QualityGovernor::resetStats() {
+    framesSeen = 0;
+    framesOver = 0;
+    std::fill(framesAtLevel, framesAtLevel + QUALITY_LEVEL_COUNT, 0);
+    worstSmoothed = smoothed;
+}
+
+double QualityGovernor::overBudgetFraction() const {
+    return framesSeen ? static_cast<double>(framesOver) / framesSeen : 0.0;
+}
+
+void QualityGovernor::report(std::ostream& out) const {
+    out << "Quality: budget " << budgetMs << " ms, smoothed " << smoothed << " ms (worst " << worstSmoothed
+        << " ms), level " << levelName(currentLevel) << ", " << levelChanges << " level changes\n";
+    out << "  frames per level:";
+    for (int i = 0; i < QUALITY_LEVEL_COUNT; i++) {
+        out << " " << levelName(static_cast<QualityLevel>(i)) << "=" << framesAtLevel[i];
+    }
+    out << "\n  " << overBudgetFraction() * 100.0 << "% of " << framesSeen << " frames over budget\n";
+}
+
+const char* QualityGovernor::levelName(QualityLevel level) {
+    static const char* names[QUALITY_LEVEL_COUNT] = { "high", "medium", "low", "minimal" };
+    return level >= 0 && level < QUALITY_LEVEL_COUNT ? names[level] : "?";
+}
+
+void QualityGovernor::changeLevel(int step) {
+    currentLevel = static_cast<QualityLevel>(currentLevel + step);
+    overFrames = 0;
+    underFrames = 0;
+    cooldownFrames = COOLDOWN_FRAMES;
+    levelChanges++;
+}
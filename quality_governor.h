@@ -0,0 +1,66 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include <SDL.h>
+#include <ostream>
+
+enum QualityLevel {
+    QUALITY_HIGH,
+    QUALITY_MEDIUM,
+    QUALITY_LOW,
+    QUALITY_MINIMAL,
+    QUALITY_LEVEL_COUNT
+};
+
+// What each quality level allows the renderer to spend.
+struct QualitySettings {
+    int maxConfetti;            // live particles
+    int confettiPerFrame;       // particles spawned per frame
+    bool snakeGradient;         // per-run shading; off draws the body in one batch
+    bool snakeOutline;          // draw the body as a 1-pixel polyline
+    int textRefreshFrames;      // HUD text is rebuilt every N frames
+};
+
+// Steps quality down when the smoothed frame time stays over budget and back
+// up when it stays well under. Separate thresholds, hold times and a cooldown
+// after each change keep it from flapping between levels.
+class QualityGovernor {
+public:
+    QualityGovernor();
+
+    // 0 disables the governor and pins the level to QUALITY_HIGH.
+    void setBudget(double ms);
+    double budget() const { return budgetMs; }
+
+    // Work time of the frame just finished, in milliseconds.
+    void onFrame(double frameMs);
+
+    QualityLevel level() const { return currentLevel; }
+    const QualitySettings& settings() const;
+    double smoothedMs() const { return smoothed; }
+
+    // Counters since the last resetStats(), for checking the budget was held.
+    void resetStats();
+    double overBudgetFraction() const;
+    void report(std::ostream& out) const;
+
+    static const char* levelName(QualityLevel level);
+
+private:
+    void changeLevel(int step);
+
+    double budgetMs;
+    double smoothed;
+    QualityLevel currentLevel;
+    int overFrames;
+    int underFrames;
+    int cooldownFrames;
+
+    Uint64 framesSeen;
+    Uint64 framesOver;
+    Uint64 framesAtLevel[QUALITY_LEVEL_COUNT];
+    int levelChanges;
+    double worstSmoothed;
+};
+
+#endif // QUALITY_GOVERNOR_H
@@ -0,0 +1,212 @@
+#include "scene_stack.h"
+#include <algorithm>
+
+Scene::Scene()
+    : preparing(false) {
+}
+
+SceneStack::SceneStack()
+    : hasPrepared(false),
+    stopping(false) {
+    stack.reserve(8);
+    pending.reserve(8);
+}
+
+SceneStack::~SceneStack() {
+    stop();
+}
+
+void SceneStack::start() {
+    if (loader.joinable()) return;
+    stopping = false;
+    loader = std::thread(&SceneStack::loaderLoop, this);
+}
+
+void SceneStack::stop() {
+    if (!loader.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    loader.join();
+
+    // Whatever finished still gets handed over so no scene is left half-prepared.
+    for (Scene* scene : prepared) {
+        scene->finishPrepare();
+        scene->preparing = false;
+    }
+    for (Scene* scene : toPrepare) scene->preparing = false;
+    prepared.clear();
+    toPrepare.clear();
+    hasPrepared = false;
+}
+
+void SceneStack::push(Scene* scene) {
+    request(PUSH, scene);
+}
+
+void SceneStack::pop() {
+    request(POP, nullptr);
+}
+
+void SceneStack::replaceTop(Scene* scene) {
+    request(REPLACE_TOP, scene);
+}
+
+void SceneStack::popTo(Scene* scene) {
+    request(POP_TO, scene);
+}
+
+bool SceneStack::contains(const Scene* scene) const {
+    return std::find(stack.begin(), stack.end(), scene) != stack.end();
+}
+
+void SceneStack::preload(Scene* scene) {
+    if (scene->preparing) return;
+
+    scene->beginPrepare();
+    if (!loader.joinable()) {
+        // No loader thread: prepare in place.
+        scene->prepare();
+        scene->finishPrepare();
+        return;
+    }
+    scene->preparing = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        toPrepare.push_back(scene);
+    }
+    wake.notify_one();
+}
+
+void SceneStack::poll() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!hasPrepared) return;
+        finishing.swap(prepared);
+        hasPrepared = false;
+    }
+    for (Scene* scene : finishing) {
+        scene->finishPrepare();
+        scene->preparing = false;
+    }
+    finishing.clear();
+    applyPending();
+}
+
+void SceneStack::update(float deltaTime) {
+    // Indexed, because a handler may push or pop.
+    for (size_t i = firstVisible(); i < stack.size(); i++) {
+        stack[i]->update(deltaTime);
+    }
+}
+
+void SceneStack::render() {
+    for (size_t i = firstVisible(); i < stack.size(); i++) {
+        stack[i]->render();
+    }
+}
+
+void SceneStack::keyDown(SDL_Keycode key) {
+    if (Scene* scene = top()) scene->keyDown(key);
+}
+
+void SceneStack::keyUp(SDL_Keycode key) {
+    if (Scene* scene = top()) scene->keyUp(key);
+}
+
+void SceneStack::mouseMotion(int x, int y) {
+    if (Scene* scene = top()) scene->mouseMotion(x, y);
+}
+
+void SceneStack::mouseWheel(int y) {
+    if (Scene* scene = top()) scene->mouseWheel(y);
+}
+
+void SceneStack::request(TransitionType type, Scene* scene) {
+    Transition transition = { type, scene };
+    if (pending.empty() && isReady(transition)) {
+        apply(transition);
+    }
+    else {
+        pending.push_back(transition);
+    }
+}
+
+bool SceneStack::isReady(const Transition& transition) const {
+    bool shows = transition.type == PUSH || transition.type == REPLACE_TOP;
+    return !shows || !transition.scene->preparing;
+}
+
+void SceneStack::apply(const Transition& transition) {
+    switch (transition.type) {
+    case PUSH:
+        if (!stack.empty()) stack.back()->obscured();
+        stack.push_back(transition.scene);
+        transition.scene->enter();
+        break;
+    case POP:
+        if (stack.empty()) break;
+        stack.back()->exit();
+        stack.pop_back();
+        if (!stack.empty()) stack.back()->revealed();
+        break;
+    case REPLACE_TOP:
+        if (!stack.empty()) {
+            stack.back()->exit();
+            stack.pop_back();
+        }
+        stack.push_back(transition.scene);
+        transition.scene->enter();
+        break;
+    case POP_TO:
+        if (!contains(transition.scene)) break;
+        if (stack.back() == transition.scene) break;
+        while (stack.back() != transition.scene) {
+            stack.back()->exit();
+            stack.pop_back();
+        }
+        stack.back()->revealed();
+        break;
+    }
+}
+
+void SceneStack::applyPending() {
+    size_t applied = 0;
+    while (applied < pending.size() && isReady(pending[applied])) {
+        apply(pending[applied]);
+        applied++;
+    }
+    pending.erase(pending.begin(), pending.begin() + applied);
+}
+
+size_t SceneStack::firstVisible() const {
+    size_t first = stack.size();
+    while (first > 0) {
+        first--;
+        if (!stack[first]->isOverlay()) break;
+    }
+    return first;
+}
+
+void SceneStack::loaderLoop() {
+    std::vector<Scene*> batch;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !toPrepare.empty(); });
+            if (stopping) return;
+            batch.swap(toPrepare);
+        }
+
+        for (Scene* scene : batch) {
+            scene->prepare();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        prepared.insert(prepared.end(), batch.begin(), batch.end());
+        hasPrepared = true;
+        batch.clear();
+    }
+}
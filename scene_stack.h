@@ -0,0 +1,111 @@
+#ifndef SCENE_STACK_H
+#define SCENE_STACK_H
+
+#include <SDL.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One screen of the game with its own update, render and input handlers.
+// Only the top scene gets input. Update and render run from the topmost
+// opaque scene upwards, so scenes covered by an opaque scene cost nothing.
+class Scene {
+public:
+    Scene();
+    virtual ~Scene() {}
+
+    // Overlays draw over the scene below them, which keeps updating.
+    virtual bool isOverlay() const { return false; }
+
+    virtual void enter() {}        // pushed
+    virtual void exit() {}         // popped
+    virtual void obscured() {}     // another scene was pushed on top
+    virtual void revealed() {}     // the scene on top was popped
+
+    virtual void update(float) {}
+    virtual void render() = 0;
+    virtual void keyDown(SDL_Keycode) {}
+    virtual void keyUp(SDL_Keycode) {}
+    virtual void mouseMotion(int, int) {}
+    virtual void mouseWheel(int) {}
+
+    // Preloading: beginPrepare() copies what the scene needs on the main
+    // thread, prepare() does the slow work on the loader thread using only
+    // those copies, and finishPrepare() hands the result to the renderer
+    // back on the main thread.
+    virtual void beginPrepare() {}
+    virtual void prepare() {}
+    virtual void finishPrepare() {}
+
+private:
+    friend class SceneStack;
+    bool preparing;
+};
+
+class SceneStack {
+public:
+    SceneStack();
+    ~SceneStack();
+
+    SceneStack(const SceneStack&) = delete;
+    SceneStack& operator=(const SceneStack&) = delete;
+
+    void start();
+    void stop();
+
+    // Transitions to a scene that is still preparing wait until it is ready;
+    // the current scenes keep running meanwhile and later transitions queue
+    // up behind it.
+    void push(Scene* scene);
+    void pop();
+    void replaceTop(Scene* scene);
+    void popTo(Scene* scene);       // pop everything above scene
+
+    Scene* top() const { return stack.empty() ? nullptr : stack.back(); }
+    bool contains(const Scene* scene) const;
+    bool isTransitioning() const { return !pending.empty(); }
+
+    // Starts preparing scene on the loader thread, ignored if it already is.
+    void preload(Scene* scene);
+
+    // Once per frame on the main thread: completes finished preloads and
+    // applies transitions that were waiting on them.
+    void poll();
+
+    void update(float deltaTime);
+    void render();
+    void keyDown(SDL_Keycode key);
+    void keyUp(SDL_Keycode key);
+    void mouseMotion(int x, int y);
+    void mouseWheel(int y);
+
+private:
+    enum TransitionType { PUSH, POP, REPLACE_TOP, POP_TO };
+
+    struct Transition {
+        TransitionType type;
+        Scene* scene;
+    };
+
+    void request(TransitionType type, Scene* scene);
+    bool isReady(const Transition& transition) const;
+    void apply(const Transition& transition);
+    void applyPending();
+    size_t firstVisible() const;
+    void loaderLoop();
+
+    std::vector<Scene*> stack;
+    std::vector<Transition> pending;
+
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Scene*> toPrepare;
+    std::vector<Scene*> prepared;
+    std::vector<Scene*> finishing;
+    bool hasPrepared;
+    bool stopping;
+};
+
+#endif // SCENE_STACK_H
@@ -0,0 +1,528 @@
+#include "scenes.h"
+#include "engine.h"
+#include "profile_zone.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <sstream>
+
+namespace {
+    const SDL_Color WHITE = { 255, 255, 255, 255 };
+
+    // Typing shared by the console, help and name entry. Returns false for
+    // keys it does not handle.
+    bool editText(std::string& text, SDL_Keycode key) {
+        if (key == SDLK_BACKSPACE) {
+            if (!text.empty()) text.pop_back();
+            return true;
+        }
+        if (key >= 32 && key <= 126) {
+            if (text.length() < 20) text += static_cast<char>(key);
+            return true;
+        }
+        return false;
+    }
+
+    void finishBaked(Engine& engine, std::vector<BakedText>& baked) {
+        for (auto& text : baked) engine.adoptText(text);
+        baked.clear();
+    }
+}
+
+// Sandbox
+
+void SandboxScene::update(float deltaTime) {
+    if (!engine.gravityMode) return;
+
+    engine.velocityY += engine.gravityAcceleration * deltaTime * 60.0f;
+    engine.rectY += static_cast<int>(engine.velocityY * deltaTime * 60.0f);
+
+    if (engine.rectY + engine.rectHeight >= engine.windowHeight) {
+        engine.rectY = engine.windowHeight - engine.rectHeight;
+        engine.velocityY = -engine.velocityY * engine.bounceFactor;
+        if (std::abs(engine.velocityY) < 1.0f) {
+            engine.velocityY = 0;
+            engine.isOnGround = true;
+        }
+    }
+
+    if (engine.isOnGround) {
+        engine.velocityY *= (1.0f - engine.groundFriction * deltaTime * 60.0f);
+    }
+}
+
+void SandboxScene::render() {
+    SDL_Rect rect = { engine.rectX, engine.rectY, engine.rectWidth, engine.rectHeight };
+    engine.fillRect(rect, engine.rectColor);
+
+    SDL_Color textColor = engine.gravityMode ? SDL_Color{ 255, 0, 0, 255 } : WHITE;
+    engine.drawText(engine.gravityText.c_str(), engine.windowWidth - 200, 10, textColor, engine.font);
+}
+
+void SandboxScene::keyDown(SDL_Keycode key) {
+    switch (key) {
+    case SDLK_e:
+        engine.toggleGravityMode("Earth Gravity is on", "Earth Gravity is off", 0.1f, 0.8f);
+        break;
+    case SDLK_m:
+        engine.toggleGravityMode("Moon Gravity is on", "Moon Gravity is off", 0.1f, 0.13f);
+        break;
+    case SDLK_r:
+        engine.rectColor = { 255, 0, 0, 255 };
+        break;
+    case SDLK_g:
+        engine.rectColor = { 0, 255, 0, 255 };
+        break;
+    case SDLK_b:
+        engine.rectColor = { 0, 0, 255, 255 };
+        break;
+    case SDLK_c:
+        engine.scenes.push(&engine.consoleScene);
+        break;
+    case SDLK_F5:
+        engine.quickSave();
+        break;
+    case SDLK_F9:
+        engine.quickLoad();
+        break;
+    }
+}
+
+void SandboxScene::mouseMotion(int x, int y) {
+    if (!engine.gravityMode) {
+        engine.handleMouseMotion(x, y);
+    }
+}
+
+void SandboxScene::mouseWheel(int y) {
+    engine.handleMouseWheel(y);
+}
+
+// Snake game
+
+void SnakeScene::enter() {
+    lastScore = engine.score;
+    wasGameOver = engine.gameOver;
+}
+
+void SnakeScene::obscured() {
+    // Key-ups go to the scene on top now, so let go of boost and rewind.
+    engine.snakeSpeed = 2;
+    engine.rewinding = false;
+    engine.scheduleSnakeStep();
+}
+
+void SnakeScene::update(float) {
+    if (engine.rewinding) {
+        engine.rewindStep();
+    }
+    else {
+        if (engine.score > lastScore) {
+            engine.audio.play(SOUND_EAT);
+        }
+        if (engine.gameOver && !wasGameOver) {
+            engine.audio.play(SOUND_GAME_OVER);
+        }
+        engine.recordRewindFrame();
+    }
+    engine.broadcastTick();
+    lastScore = engine.score;
+    wasGameOver = engine.gameOver;
+
+    engine.updateCamera();
+    if (engine.worldMode) {
+        engine.world.updateStreaming(engine.camera);
+    }
+}
+
+void SnakeScene::render() {
+    engine.renderSnakeGame();
+}
+
+void SnakeScene::steer(Direction direction, Direction opposite) {
+    if (engine.snakeDirection == opposite) return;
+
+    engine.snakeDirection = direction;
+    if (engine.snakeSpeed != engine.snakeBoostedSpeed) engine.audio.play(SOUND_BOOST, 0.5f);
+    engine.snakeSpeed = engine.snakeBoostedSpeed;
+    engine.scheduleSnakeStep();
+}
+
+void SnakeScene::keyDown(SDL_Keycode key) {
+    switch (key) {
+    case SDLK_UP: steer(UP, DOWN); break;
+    case SDLK_DOWN: steer(DOWN, UP); break;
+    case SDLK_LEFT: steer(LEFT, RIGHT); break;
+    case SDLK_RIGHT: steer(RIGHT, LEFT); break;
+    case SDLK_c:
+        engine.scenes.push(&engine.consoleScene);
+        break;
+    case SDLK_s:
+        engine.isPaused = !engine.isPaused;
+        engine.scheduleSnakeStep();
+        break;
+    case SDLK_BACKSPACE:
+        if (!engine.gameOver) {
+            engine.rewinding = true;
+            engine.scheduleSnakeStep();
+        }
+        break;
+    case SDLK_F5:
+        engine.quickSave();
+        break;
+    case SDLK_F9:
+        engine.quickLoad();
+        break;
+    case SDLK_x:
+        engine.resetSnakeGame();
+        engine.inputText = "";
+        break;
+    }
+}
+
+void SnakeScene::keyUp(SDL_Keycode key) {
+    switch (key) {
+    case SDLK_UP:
+    case SDLK_DOWN:
+    case SDLK_LEFT:
+    case SDLK_RIGHT:
+        engine.snakeSpeed = 2;
+        engine.scheduleSnakeStep();
+        break;
+    case SDLK_BACKSPACE:
+        engine.rewinding = false;
+        engine.scheduleSnakeStep();
+        break;
+    }
+}
+
+// Console
+
+void ConsoleScene::enter() {
+    // Help is the usual next stop, so have its text ready by then.
+    engine.scenes.preload(&engine.helpScene);
+}
+
+void ConsoleScene::render() {
+    engine.drawTextBox();
+    engine.drawInputText();
+}
+
+void ConsoleScene::keyDown(SDL_Keycode key) {
+    switch (key) {
+    case SDLK_RETURN:
+        runCommand();
+        break;
+    case SDLK_x:
+        engine.resetSnakeGame();
+        engine.inputText = "";
+        break;
+    case SDLK_f:
+        engine.toggleFullscreen();
+        close();
+        break;
+    default:
+        editText(engine.inputText, key);
+        break;
+    }
+}
+
+void ConsoleScene::close() {
+    engine.scenes.pop();
+    engine.inputText = "";
+}
+
+void ConsoleScene::runCommand() {
+    std::string& inputText = engine.inputText;
+    if (inputText.find("background is ") == 0) {
+        engine.setBackgroundColor(inputText.substr(14));
+        close();
+    }
+    else if (inputText.find("play world") == 0) {
+        int worldSizeCells = 100000;
+        std::istringstream iss(inputText.substr(10));
+        std::string token;
+        while (iss >> token) {
+            if (token == "size" && iss >> worldSizeCells) {}
+        }
+        inputText = "";
+        engine.startWorldGame(worldSizeCells);
+    }
+    else if (inputText == "play mode1") {
+        inputText = "";
+        engine.startSnakeGame(MODE_1);
+    }
+    else if (inputText == "play mode2") {
+        inputText = "";
+        engine.startSnakeGame(MODE_2);
+    }
+    else if (inputText.find("play mode3") == 0) {
+        int customTime = 120;
+        int customFoodGoal = 20;
+        std::istringstream iss(inputText.substr(10));
+        std::string token;
+        while (iss >> token) {
+            if (token == "time" && iss >> customTime) {}
+            else if (token == "food" && iss >> customFoodGoal) {}
+        }
+        inputText = "";
+        engine.startSnakeGame(MODE_3, customTime, customFoodGoal);
+    }
+    else if (inputText == "help") {
+        inputText = "";
+        engine.scenes.replaceTop(&engine.helpScene);
+    }
+    else if (inputText == "restart") {
+        inputText = "";
+        engine.resetSnakeGame();
+        engine.startSnakeGame(engine.currentMode, engine.timer, engine.foodGoal);
+    }
+}
+
+// Help
+
+void HelpScene::enter() {
+    buildLines();
+}
+
+void HelpScene::render() {
+    PROFILE_ZONE("renderHelp");
+    engine.drawTextBox();
+
+    int lineHeight = 20;
+    int startY = engine.windowHeight / 2 - 130;
+    for (size_t i = 0; i < lines.size(); i++) {
+        engine.drawText(lines[i].c_str(), engine.windowWidth / 2 - 390, startY + static_cast<int>(i) * lineHeight, WHITE, engine.font);
+    }
+}
+
+void HelpScene::buildLines() {
+    static const char* const staticHelpText[] = {
+        "Shortcut Keys:", "C: Open/Close Chat Box", "X: Return to Main Menu", "E: Toggle Earth Gravity",
+        "M: Toggle Moon Gravity", "R: Change Rectangle Color to Red", "G: Change Rectangle Color to Green",
+        "B: Change Rectangle Color to Blue", "S: Pause/Resume Game", "Arrow Keys: Move Snake",
+        "Backspace: Delete Last Character in Chat", "Type 'play mode1' for Mode 1 (120s, 20 food)",
+        "Type 'play mode2' for Mode 2 (unlimited)", "Type 'play mode3 time x food y' for Mode 3",
+        "F5/F9: Quick Save/Load, Hold Backspace: Rewind",
+        "Leaderboard (top 5; the full table opens after each game):", "Mode 1 (Fastest Time, Most Food):"
+    };
+
+    lines.assign(std::begin(staticHelpText), std::end(staticHelpText));
+    appendTopScores(&engine.mode1Scores, true);
+    lines.push_back("Mode 2 (Most Food):");
+    appendTopScores(&engine.mode2Scores, false);
+}
+
+// Rows formatted like the scoreboard's, whatever the table size.
+void HelpScene::appendTopScores(const ScoreTable* scores, bool timed) {
+    ScoreTableSource table;
+    table.set(scores, timed, ListView::npos);
+    FixedText<ListView::ROW_TEXT_BYTES> text;
+    size_t count = std::min(table.rowCount(), static_cast<size_t>(TOP_SCORES));
+    for (size_t row = 0; row < count; row++) {
+        text.clear();
+        table.formatRow(row, text);
+        lines.push_back(text.c_str());
+    }
+}
+
+void HelpScene::beginPrepare() {
+    buildLines();
+}
+
+void HelpScene::prepare() {
+    for (const auto& line : lines) {
+        baked.push_back({ line, engine.font, WHITE, engine.bakeText(line.c_str(), WHITE, engine.font) });
+    }
+}
+
+void HelpScene::finishPrepare() {
+    finishBaked(engine, baked);
+}
+
+// Name entry
+
+void NameEntryScene::enter() {
+    engine.inputText = "";
+}
+
+void NameEntryScene::render() {
+    engine.drawTextBox();
+    engine.drawInputText();
+    engine.drawText("Enter your name:", engine.windowWidth / 2 - 100, engine.windowHeight / 2 + 25, WHITE, engine.font);
+    engine.drawText(engine.inputText.c_str(), engine.windowWidth / 2 - 100, engine.windowHeight / 2 + 50, WHITE, engine.font);
+}
+
+void NameEntryScene::keyDown(SDL_Keycode key) {
+    switch (key) {
+    case SDLK_RETURN:
+        if (!engine.inputText.empty()) {
+            engine.nameEntered.signal();
+        }
+        break;
+    case SDLK_x:
+        engine.resetSnakeGame();
+        engine.inputText = "";
+        break;
+    case SDLK_f:
+        engine.toggleFullscreen();
+        break;
+    default:
+        editText(engine.inputText, key);
+        break;
+    }
+}
+
+// Scoreboard
+
+void ScoreTableSource::set(const ScoreTable* table, bool timedMode, size_t playerRow) {
+    scores = table;
+    timed = timedMode;
+    yourRow = playerRow;
+}
+
+void ScoreTableSource::formatRow(size_t row, TextBuilder& entry) const {
+    const ScoreEntry& score = (*scores)[row];
+    entry.append(" | ").appendRight(static_cast<long long>(row + 1), 5).append(" | ");
+    size_t column = entry.length();
+    entry.append(score.playerName).padTo(column + 15).append(" | ");
+    column = entry.length();
+    if (timed) {
+        entry.append(score.food).padTo(column + 5).append(" | ");
+        column = entry.length();
+        entry.append(score.time).append('s').padTo(column + 7);
+    }
+    else {
+        entry.append(score.food).padTo(column + 5).append(" | --");
+    }
+    if (row == yourRow) {
+        entry.append(" (You)");
+    }
+}
+
+// Rows start two lines below the middle, as they always have, and stop in
+// time to leave the footer on screen however long the table is.
+SDL_Rect ScoreboardScene::listArea() const {
+    int top = engine.windowHeight / 2 + 2 * ROW_HEIGHT;
+    int rowsThatFit = (engine.windowHeight - top) / ROW_HEIGHT - 3;
+    int visible = std::max(3, std::min(MAX_VISIBLE_ROWS, rowsThatFit));
+    return { engine.windowWidth / 2 - 320, top, 640, visible * ROW_HEIGHT };
+}
+
+void ScoreboardScene::formatFooter(TextBuilder& footer) const {
+    if (!searching) {
+        footer.append("Up/Down/PgUp/PgDn: scroll   J: your rank   /: search   Enter or X: return");
+        return;
+    }
+    footer.append("Find player: ").append(query).append('_');
+    switch (list.searchStatus()) {
+    case ListView::SEARCH_RUNNING: footer.append("   searching..."); break;
+    case ListView::SEARCH_NOT_FOUND: footer.append("   no match"); break;
+    default: break;
+    }
+    footer.append("   Enter: next   Esc: done");
+}
+
+void ScoreboardScene::update(float deltaTime) {
+    list.update(deltaTime);
+}
+
+void ScoreboardScene::render() {
+    PROFILE_ZONE("renderScoreboard");
+    SDL_Rect area = listArea();
+    engine.drawText(title.c_str(), engine.windowWidth / 2, engine.windowHeight / 2, WHITE, engine.font, true);
+    list.render(engine, area, engine.font, engine.boldFont);
+
+    FixedText<128> footer;
+    formatFooter(footer);
+    engine.drawText(footer.c_str(), engine.windowWidth / 2, area.y + area.h + ROW_HEIGHT / 2, WHITE, engine.font, true);
+}
+
+void ScoreboardScene::keyDown(SDL_Keycode key) {
+    if (searching) {
+        switch (key) {
+        case SDLK_RETURN:
+            list.search(query, true);
+            break;
+        case SDLK_ESCAPE:
+            searching = false;
+            list.cancelSearch();
+            break;
+        default:
+            // Each keystroke narrows the search from the current match.
+            if (editText(query, key)) list.search(query, false);
+            break;
+        }
+        return;
+    }
+
+    switch (key) {
+    case SDLK_RETURN:
+    case SDLK_x:
+        close();
+        break;
+    case SDLK_UP: list.moveSelection(-1); break;
+    case SDLK_DOWN: list.moveSelection(1); break;
+    case SDLK_PAGEUP: list.moveSelection(-list.visibleRows()); break;
+    case SDLK_PAGEDOWN: list.moveSelection(list.visibleRows()); break;
+    case SDLK_HOME: list.select(0); break;
+    case SDLK_END: list.select(ListView::npos); break;
+    case SDLK_j:
+        list.center(engine.savedScoreRow, true);
+        break;
+    case SDLK_SLASH:
+        searching = true;
+        query.clear();
+        break;
+    }
+}
+
+void ScoreboardScene::mouseWheel(int y) {
+    list.scrollBy(-3.0 * y);
+}
+
+void ScoreboardScene::close() {
+    engine.showConfetti = false;
+    engine.confettiParticles.clear();
+    engine.resetSnakeGame();
+}
+
+void ScoreboardScene::beginPrepare() {
+    bool timed = engine.currentMode == MODE_1;
+    const ScoreTable* scores = timed ? &engine.mode1Scores :
+        engine.currentMode == MODE_2 ? &engine.mode2Scores : nullptr;
+    title = timed ? "Mode 1 Leaderboard (Fastest Time, Most Food)" : "Mode 2 Leaderboard (Most Food)";
+    table.set(scores, timed, engine.savedScoreRow);
+    list.setSource(&table);
+    list.setRowHeight(ROW_HEIGHT);
+    list.setHighlight(engine.savedScoreRow);
+    list.setPageRows(listArea().h / ROW_HEIGHT);
+    list.center(engine.savedScoreRow, false);
+    searching = false;
+    query.clear();
+
+    // The first frame's text, so it can be baked ahead of time.
+    rows.clear();
+    rows.push_back({ title, false });
+    FixedText<ListView::ROW_TEXT_BYTES> text;
+    size_t end = std::min(table.rowCount(), list.firstVisibleRow() + list.visibleRows());
+    for (size_t row = list.firstVisibleRow(); row < end; row++) {
+        text.clear();
+        table.formatRow(row, text);
+        rows.push_back({ text.c_str(), row == engine.savedScoreRow });
+    }
+    text.clear();
+    formatFooter(text);
+    rows.push_back({ text.c_str(), false });
+}
+
+void ScoreboardScene::prepare() {
+    for (const auto& row : rows) {
+        TTF_Font* rowFont = row.highlight ? engine.boldFont : engine.font;
+        baked.push_back({ row.text, rowFont, WHITE, engine.bakeText(row.text.c_str(), WHITE, rowFont) });
+    }
+}
+
+void ScoreboardScene::finishPrepare() {
+    finishBaked(engine, baked);
+}
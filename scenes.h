@@ -0,0 +1,171 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <string>
+#include <vector>
+#include "game_types.h"
+#include "list_view.h"
+#include "scene_stack.h"
+#include "score_table.h"
+
+class Engine;
+
+// Text rendered to a surface on the scene loader thread; the main thread
+// turns it into a cached texture in finishPrepare().
+struct BakedText {
+    std::string text;
+    TTF_Font* font;
+    SDL_Color color;
+    SDL_Surface* surface;
+};
+
+// The movable rectangle with the gravity toggles. Always at the bottom.
+class SandboxScene : public Scene {
+public:
+    explicit SandboxScene(Engine& engine) : engine(engine) {}
+
+    void update(float deltaTime) override;
+    void render() override;
+    void keyDown(SDL_Keycode key) override;
+    void mouseMotion(int x, int y) override;
+    void mouseWheel(int y) override;
+
+private:
+    Engine& engine;
+};
+
+class SnakeScene : public Scene {
+public:
+    explicit SnakeScene(Engine& engine) : engine(engine), lastScore(0), wasGameOver(false) {}
+
+    void enter() override;
+    void obscured() override;
+    void update(float deltaTime) override;
+    void render() override;
+    void keyDown(SDL_Keycode key) override;
+    void keyUp(SDL_Keycode key) override;
+
+private:
+    void steer(Direction direction, Direction opposite);
+
+    Engine& engine;
+    int lastScore;
+    bool wasGameOver;
+};
+
+// The chat box: typed commands start games, change the background and so on.
+class ConsoleScene : public Scene {
+public:
+    explicit ConsoleScene(Engine& engine) : engine(engine) {}
+
+    bool isOverlay() const override { return true; }
+    void enter() override;
+    void render() override;
+    void keyDown(SDL_Keycode key) override;
+
+protected:
+    void runCommand();
+    void close();
+
+    Engine& engine;
+};
+
+// The console showing the shortcut list and top scores instead of the typed
+// text. Typing still goes to the console. Its lines are rendered ahead of
+// time whenever the console opens.
+class HelpScene : public ConsoleScene {
+public:
+    explicit HelpScene(Engine& engine) : ConsoleScene(engine) {}
+
+    void enter() override;
+    void render() override;
+    void beginPrepare() override;
+    void prepare() override;
+    void finishPrepare() override;
+
+private:
+    // The overlay keeps a fixed-size summary; the scrolling list is the
+    // scoreboard's.
+    static const int TOP_SCORES = 5;
+
+    void buildLines();
+    void appendTopScores(const ScoreTable* scores, bool timed);
+
+    std::vector<std::string> lines;
+    std::vector<BakedText> baked;
+};
+
+class NameEntryScene : public Scene {
+public:
+    explicit NameEntryScene(Engine& engine) : engine(engine) {}
+
+    bool isOverlay() const override { return true; }
+    void enter() override;
+    void render() override;
+    void keyDown(SDL_Keycode key) override;
+
+private:
+    Engine& engine;
+};
+
+// One mode's score table as list rows, read straight from the table.
+class ScoreTableSource : public ListSource {
+public:
+    ScoreTableSource() : scores(nullptr), timed(false), yourRow(ListView::npos) {}
+
+    // timed adds the time column (mode 1); yourRow is marked "(You)".
+    void set(const ScoreTable* table, bool timedMode, size_t playerRow);
+
+    size_t rowCount() const override { return scores ? scores->size() : 0; }
+    void formatRow(size_t row, TextBuilder& text) const override;
+    const std::string& rowName(size_t row) const override { return (*scores)[row].playerName; }
+
+private:
+    const ScoreTable* scores;
+    bool timed;
+    size_t yourRow;
+};
+
+// Results after a game: the whole table of the mode just played in a
+// scrolling list that opens on the player's row. Preparing it renders the
+// first visible rows off the main thread, so the switch from name entry does
+// not stall a frame.
+class ScoreboardScene : public Scene {
+public:
+    explicit ScoreboardScene(Engine& engine) : engine(engine), searching(false) {}
+
+    void update(float deltaTime) override;
+    void render() override;
+    void keyDown(SDL_Keycode key) override;
+    void mouseWheel(int y) override;
+    void beginPrepare() override;
+    void prepare() override;
+    void finishPrepare() override;
+
+    struct Row {
+        std::string text;
+        bool highlight;
+    };
+
+private:
+    static const int ROW_HEIGHT = 20;
+    static const int MAX_VISIBLE_ROWS = 10;
+
+    SDL_Rect listArea() const;
+    void formatFooter(TextBuilder& text) const;
+    void close();
+
+    Engine& engine;
+    ScoreTableSource table;
+    ListView list;
+    std::string title;
+    bool searching;             // typing goes to the name search
+    std::string query;
+
+    std::vector<Row> rows;      // drawn on the first frame; baked while preparing
+    std::vector<BakedText> baked;
+};
+
+#endif // SCENES_H
@@ -0,0 +1,64 @@
+#include "score_table.h"
+#include <algorithm>
+#include <iterator>
+
+const ScoreEntry& ScoreTable::operator[](size_t row) const {
+    size_t block = lastBlock;
+    if (block >= blocks.size() || row < starts[block] || row - starts[block] >= blocks[block].size()) {
+        if (block + 1 < blocks.size() && row >= starts[block + 1] && row - starts[block + 1] < blocks[block + 1].size()) {
+            block++;
+        }
+        else {
+            block = static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), row) - starts.begin()) - 1;
+        }
+        lastBlock = block;
+    }
+    return blocks[block][row - starts[block]];
+}
+
+size_t ScoreTable::insert(const ScoreEntry& entry) {
+    if (blocks.empty()) {
+        blocks.emplace_back();
+        starts.push_back(0);
+    }
+
+    // The last block whose first entry does not come after the new one.
+    auto after = std::upper_bound(blocks.begin() + 1, blocks.end(), entry, [this](const ScoreEntry& value, const std::vector<ScoreEntry>& block) {
+        return before(value, block.front());
+        });
+    size_t block = static_cast<size_t>(after - blocks.begin()) - 1;
+    std::vector<ScoreEntry>& rows = blocks[block];
+    auto position = std::upper_bound(rows.begin(), rows.end(), entry, before);
+    size_t row = starts[block] + static_cast<size_t>(position - rows.begin());
+    rows.insert(position, entry);
+    count++;
+    for (size_t i = block + 1; i < starts.size(); i++) starts[i]++;
+
+    if (rows.size() > BLOCK_ROWS) {
+        std::vector<ScoreEntry> upper(std::make_move_iterator(rows.begin() + rows.size() / 2), std::make_move_iterator(rows.end()));
+        rows.resize(rows.size() / 2);
+        size_t upperStart = starts[block] + rows.size();
+        blocks.insert(blocks.begin() + block + 1, std::move(upper));
+        starts.insert(starts.begin() + block + 1, upperStart);
+    }
+    return row;
+}
+
+void ScoreTable::assign(std::vector<ScoreEntry>& entries) {
+    std::stable_sort(entries.begin(), entries.end(), before);
+    blocks.clear();
+    starts.clear();
+    count = entries.size();
+    // Half full, so the first inserts into any block do not split it.
+    for (size_t first = 0; first < entries.size(); first += BLOCK_ROWS / 2) {
+        size_t last = std::min(entries.size(), first + BLOCK_ROWS / 2);
+        blocks.emplace_back(std::make_move_iterator(entries.begin() + first), std::make_move_iterator(entries.begin() + last));
+        starts.push_back(first);
+    }
+}
+
+size_t ScoreTable::memoryBytes() const {
+    size_t bytes = blocks.capacity() * sizeof(std::vector<ScoreEntry>) + starts.capacity() * sizeof(size_t);
+    for (const auto& block : blocks) bytes += block.capacity() * sizeof(ScoreEntry);
+    return bytes;
+}
@@ -0,0 +1,76 @@
+#include "score_writer.h"
+#include "log.h"
+#include <fstream>
+
+ScoreWriter::ScoreWriter()
+    : path("scores.txt"),
+    saveMetric(nullptr),
+    stopping(false) {
+}
+
+ScoreWriter::~ScoreWriter() {
+    stop();
+}
+
+void ScoreWriter::start(const std::string& filePath, MetricHistogram& saveMs) {
+    if (writer.joinable()) return;
+    path = filePath;
+    saveMetric = &saveMs;
+    stopping = false;
+    writer = std::thread(&ScoreWriter::writerLoop, this);
+}
+
+void ScoreWriter::stop() {
+    if (!writer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+void ScoreWriter::append(GameMode mode, const ScoreEntry& entry) {
+    std::string text = mode == MODE_1 ? "Mode 1 Scores:\n" : "Mode 2 Scores:\n";
+    text += entry.playerName + " " + std::to_string(entry.food);
+    if (mode == MODE_1) text += " " + std::to_string(entry.time);
+    text += "\n";
+
+    if (!writer.joinable()) {
+        write(text);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued += text;
+    }
+    wake.notify_one();
+}
+
+void ScoreWriter::writerLoop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queued.empty(); });
+            // Drain before exiting: a score queued just before quit still lands.
+            if (queued.empty()) return;
+            writing.swap(queued);
+        }
+        write(writing);
+        writing.clear();
+    }
+}
+
+void ScoreWriter::write(const std::string& text) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    std::ofstream file(path, std::ios::app);
+    if (!file.is_open()) {
+        LOG_ERROR("Could not save scores to {}", path);
+        return;
+    }
+    file << text;
+    file.close();
+    if (saveMetric) {
+        saveMetric->observe((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef SCORE_WRITER_H
+#define SCORE_WRITER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "game_types.h"
+#include "metrics.h"
+
+// Saves scores by appending them to scores.txt on a background thread. Each
+// save adds a section header and one line, which loadScores() reads like
+// any other section, so saving costs the same whatever the table size.
+// stop() writes everything still queued before it returns, so quitting
+// right after a game keeps its score.
+class ScoreWriter {
+public:
+    ScoreWriter();
+    ~ScoreWriter();
+
+    ScoreWriter(const ScoreWriter&) = delete;
+    ScoreWriter& operator=(const ScoreWriter&) = delete;
+
+    // saveMs gets the time of each file write.
+    void start(const std::string& filePath, MetricHistogram& saveMs);
+    void stop();
+
+    // Appended in place when the writer is not running.
+    void append(GameMode mode, const ScoreEntry& entry);
+
+private:
+    void writerLoop();
+    void write(const std::string& text);
+
+    std::string path;
+    MetricHistogram* saveMetric;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::string queued;
+    std::string writing;
+    bool stopping;
+};
+
+#endif // SCORE_WRITER_H
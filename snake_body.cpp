@@ -0,0 +1,139 @@
+#include "snake_body.h"
+
+namespace {
+    void directionStep(int direction, int& dx, int& dy) {
+        dx = dy = 0;
+        switch (direction) {
+        case UP: dy = -1; break;
+        case DOWN: dy = 1; break;
+        case LEFT: dx = -1; break;
+        case RIGHT: dx = 1; break;
+        }
+    }
+
+    SDL_Point runEnd(const SnakeRun& run) {
+        int dx, dy;
+        directionStep(run.direction, dx, dy);
+        return { run.tailX + dx * (run.length - 1), run.tailY + dy * (run.length - 1) };
+    }
+}
+
+SnakeBody::SnakeBody()
+    : runs(16),
+    first(0),
+    count(0),
+    firstIndex(0),
+    cellCount(0) {
+}
+
+void SnakeBody::reset(int x, int y, Direction direction) {
+    clear();
+    pushRun({ x / CELL_PIXELS, y / CELL_PIXELS, 1, static_cast<Uint16>(direction) });
+    cellCount = 1;
+}
+
+void SnakeBody::clear() {
+    first = 0;
+    count = 0;
+    firstIndex = 0;
+    cellCount = 0;
+}
+
+SDL_Point SnakeBody::head() const {
+    return runHead(count - 1);
+}
+
+SDL_Point SnakeBody::tail() const {
+    return runTail(0);
+}
+
+SDL_Point SnakeBody::runTail(size_t index) const {
+    const SnakeRun& r = run(index);
+    return { r.tailX * CELL_PIXELS, r.tailY * CELL_PIXELS };
+}
+
+SDL_Point SnakeBody::runHead(size_t index) const {
+    SDL_Point cell = runEnd(run(index));
+    return { cell.x * CELL_PIXELS, cell.y * CELL_PIXELS };
+}
+
+void SnakeBody::extendHead(Direction direction) {
+    SnakeRun& headRun = at(count - 1);
+    if (headRun.direction == direction && headRun.length < 0xFFFF) {
+        headRun.length++;
+    }
+    else {
+        int dx, dy;
+        directionStep(direction, dx, dy);
+        SDL_Point cell = runEnd(headRun);
+        pushRun({ cell.x + dx, cell.y + dy, 1, static_cast<Uint16>(direction) });
+    }
+    cellCount++;
+}
+
+void SnakeBody::trimTail() {
+    if (cellCount <= 1) return;
+
+    SnakeRun& tailRun = at(0);
+    int dx, dy;
+    directionStep(tailRun.direction, dx, dy);
+    tailRun.tailX += dx;
+    tailRun.tailY += dy;
+    if (--tailRun.length == 0) {
+        first = (first + 1) & (runs.size() - 1);
+        count--;
+        firstIndex++;
+    }
+    cellCount--;
+}
+
+bool SnakeBody::hitsBody(int x, int y) const {
+    if (x < 0 || y < 0 || x % CELL_PIXELS || y % CELL_PIXELS) return false;
+    int cellX = x / CELL_PIXELS;
+    int cellY = y / CELL_PIXELS;
+
+    for (size_t i = 0; i < count; i++) {
+        const SnakeRun& r = run(i);
+        int length = r.length - (i == count - 1 ? 1 : 0);   // leave out the head cell
+        int dx, dy;
+        directionStep(r.direction, dx, dy);
+
+        int offset;
+        if (dx != 0) {
+            if (cellY != r.tailY) continue;
+            offset = (cellX - r.tailX) * dx;
+        }
+        else {
+            if (cellX != r.tailX) continue;
+            offset = (cellY - r.tailY) * dy;
+        }
+        if (offset >= 0 && offset < length) return true;
+    }
+    return false;
+}
+
+void SnakeBody::copyRuns(std::vector<SnakeRun>& out) const {
+    out.resize(count);
+    for (size_t i = 0; i < count; i++) out[i] = run(i);
+}
+
+void SnakeBody::assign(const SnakeRun* source, size_t runTotal, Uint64 firstRun) {
+    clear();
+    for (size_t i = 0; i < runTotal; i++) {
+        pushRun(source[i]);
+        cellCount += source[i].length;
+    }
+    firstIndex = firstRun;
+}
+
+void SnakeBody::pushRun(const SnakeRun& run) {
+    if (count == runs.size()) {
+        // Unroll the ring into a buffer twice the size.
+        std::vector<SnakeRun> grown(runs.size() * 2);
+        for (size_t i = 0; i < count; i++) grown[i] = this->run(i);
+        runs.swap(grown);
+        first = 0;
+    }
+    at(count) = run;
+    count++;
+}
@@ -0,0 +1,66 @@
+#ifndef SNAKE_BODY_H
+#define SNAKE_BODY_H
+
+#include <SDL.h>
+#include <vector>
+#include "game_types.h"
+
+// One straight stretch of the snake. Cells are tail + k * direction for
+// k in [0, length).
+struct SnakeRun {
+    Sint32 tailX, tailY;   // cell coordinates of the end nearest the tail
+    Uint16 length;
+    Uint16 direction;      // Direction from tail to head
+};
+
+// Snake body stored as a list of straight runs instead of one point per step,
+// so memory and draw calls grow with the number of turns, not the length.
+// Positions are in pixels on the outside and cells inside.
+class SnakeBody {
+public:
+    static constexpr int CELL_PIXELS = 4;
+    static constexpr int MAX_CELLS = 1 << 28;  // per axis, so pixel positions fit an int
+
+    SnakeBody();
+
+    void reset(int x, int y, Direction direction);
+    void clear();
+
+    bool empty() const { return cellCount == 0; }
+    size_t length() const { return cellCount; }
+    SDL_Point head() const;
+    SDL_Point tail() const;
+
+    // Both O(1): extending starts a new run only when the direction changes.
+    void extendHead(Direction direction);
+    void trimTail();
+
+    // True if any cell other than the head is at (x, y). O(runs).
+    bool hitsBody(int x, int y) const;
+
+    // Runs from tail (0) to head.
+    size_t runCount() const { return count; }
+    const SnakeRun& run(size_t index) const { return runs[(first + index) & (runs.size() - 1)]; }
+    SDL_Point runTail(size_t index) const;
+    SDL_Point runHead(size_t index) const;
+
+    // Sequence number of the tail run; every new run gets the next number, so
+    // two snapshots of the same snake can be lined up run by run.
+    Uint64 firstRunIndex() const { return firstIndex; }
+    void copyRuns(std::vector<SnakeRun>& out) const;
+    void assign(const SnakeRun* source, size_t runTotal, Uint64 firstRun);
+
+    size_t memoryBytes() const { return runs.capacity() * sizeof(SnakeRun); }
+
+private:
+    SnakeRun& at(size_t index) { return runs[(first + index) & (runs.size() - 1)]; }
+    void pushRun(const SnakeRun& run);
+
+    std::vector<SnakeRun> runs;   // ring buffer, power-of-two size
+    size_t first;
+    size_t count;
+    Uint64 firstIndex;
+    size_t cellCount;
+};
+
+#endif // SNAKE_BODY_H
@@ -0,0 +1,226 @@
+#include "snapshot.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const Uint32 SNAPSHOT_MAGIC = 0x50414E53; // "SNAP"
+    const Uint32 SNAPSHOT_VERSION = 4;
+
+    void writeVarint(std::vector<Uint8>& out, size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<Uint8>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<Uint8>(value));
+    }
+
+    bool readVarint(const Uint8*& data, const Uint8* end, size_t& value) {
+        value = 0;
+        for (int shift = 0; data < end && shift < 64; shift += 7) {
+            Uint8 byte = *data++;
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // The header as it is written out. Delta bases go through this too, so a
+    // decoded snapshot and a freshly captured one make the same base.
+    SnapshotHeader storedHeader(const Snapshot& snapshot) {
+        SnapshotHeader header = snapshot.header;
+        header.magic = SNAPSHOT_MAGIC;
+        header.version = SNAPSHOT_VERSION;
+        header.snakeRunCount = static_cast<Uint32>(snapshot.snake.size());
+        header.particleCount = static_cast<Uint32>(snapshot.particles.size());
+        return header;
+    }
+
+    // XORs count bytes of src into dst, a word at a time.
+    void xorBytes(Uint8* dst, const Uint8* src, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            Uint64 a, b;
+            std::memcpy(&a, dst + i, 8);
+            std::memcpy(&b, src + i, 8);
+            a ^= b;
+            std::memcpy(dst + i, &a, 8);
+        }
+        for (; i < count; i++) dst[i] ^= src[i];
+    }
+
+    // XORs the elements of target that share an index with base.
+    template <typename T>
+    void xorAligned(Uint8* dst, Uint64 targetFirst, size_t targetCount, const std::vector<T>& base, Uint64 baseFirst) {
+        Uint64 overlapFirst = std::max(targetFirst, baseFirst);
+        Uint64 overlapEnd = std::min(targetFirst + targetCount, baseFirst + base.size());
+        if (overlapFirst >= overlapEnd) return;
+        xorBytes(dst + (overlapFirst - targetFirst) * sizeof(T),
+            reinterpret_cast<const Uint8*>(base.data() + (overlapFirst - baseFirst)),
+            static_cast<size_t>(overlapEnd - overlapFirst) * sizeof(T));
+    }
+
+    // Stream of (zero run, literal run, literal bytes) tokens.
+    void compressZeroRuns(const Uint8* src, size_t size, std::vector<Uint8>& out) {
+        size_t i = 0;
+        while (i < size) {
+            size_t zeroStart = i;
+            while (i + 8 <= size) {
+                Uint64 word;
+                std::memcpy(&word, src + i, 8);
+                if (word != 0) break;
+                i += 8;
+            }
+            while (i < size && src[i] == 0) i++;
+
+            size_t literalStart = i;
+            while (i < size) {
+                if (src[i] == 0 && i + 4 <= size && src[i + 1] == 0 && src[i + 2] == 0 && src[i + 3] == 0) break;
+                i++;
+            }
+
+            writeVarint(out, literalStart - zeroStart);
+            writeVarint(out, i - literalStart);
+            out.insert(out.end(), src + literalStart, src + i);
+        }
+    }
+
+    bool expandZeroRuns(const Uint8* data, const Uint8* end, Uint8* dst, size_t size) {
+        size_t written = 0;
+        while (data < end) {
+            size_t zeros, literals;
+            if (!readVarint(data, end, zeros) || !readVarint(data, end, literals)) return false;
+            if (zeros + literals > size - written || literals > static_cast<size_t>(end - data)) return false;
+            std::memset(dst + written, 0, zeros);
+            written += zeros;
+            std::memcpy(dst + written, data, literals);
+            written += literals;
+            data += literals;
+        }
+        return written == size;
+    }
+}
+
+void encodeSnapshot(const Snapshot& target, const Snapshot* base, std::vector<Uint8>& scratch, std::vector<Uint8>& out) {
+    SnapshotHeader header = storedHeader(target);
+
+    size_t snakeBytes = target.snake.size() * sizeof(SnakeRun);
+    size_t particleBytes = target.particles.size() * sizeof(Confetti);
+    size_t rawSize = sizeof(SnapshotHeader) + snakeBytes + particleBytes;
+    scratch.resize(rawSize);
+
+    Uint8* headerBytes = scratch.data();
+    Uint8* snakeData = headerBytes + sizeof(SnapshotHeader);
+    Uint8* particleData = snakeData + snakeBytes;
+    std::memcpy(headerBytes, &header, sizeof(SnapshotHeader));
+    if (snakeBytes) std::memcpy(snakeData, target.snake.data(), snakeBytes);
+    if (particleBytes) std::memcpy(particleData, target.particles.data(), particleBytes);
+
+    if (base) {
+        SnapshotHeader baseHeader = storedHeader(*base);
+        xorBytes(headerBytes, reinterpret_cast<const Uint8*>(&baseHeader), sizeof(SnapshotHeader));
+        xorAligned(snakeData, header.snakeFirstRun, target.snake.size(), base->snake, base->header.snakeFirstRun);
+        xorAligned(particleData, 0, target.particles.size(), base->particles, 0);
+    }
+
+    out.clear();
+    writeVarint(out, rawSize);
+    compressZeroRuns(scratch.data(), rawSize, out);
+}
+
+bool decodeSnapshot(const Uint8* data, size_t size, const Snapshot* base, std::vector<Uint8>& scratch, Snapshot& out) {
+    const Uint8* end = data + size;
+    size_t rawSize;
+    if (!readVarint(data, end, rawSize) || rawSize < sizeof(SnapshotHeader)) return false;
+
+    scratch.resize(rawSize);
+    if (!expandZeroRuns(data, end, scratch.data(), rawSize)) return false;
+
+    const Uint8* headerBytes = scratch.data();
+    std::memcpy(&out.header, headerBytes, sizeof(SnapshotHeader));
+    if (base) {
+        SnapshotHeader baseHeader = storedHeader(*base);
+        xorBytes(reinterpret_cast<Uint8*>(&out.header), reinterpret_cast<const Uint8*>(&baseHeader), sizeof(SnapshotHeader));
+    }
+    if (out.header.magic != SNAPSHOT_MAGIC || out.header.version != SNAPSHOT_VERSION) return false;
+
+    size_t snakeBytes = static_cast<size_t>(out.header.snakeRunCount) * sizeof(SnakeRun);
+    size_t particleBytes = static_cast<size_t>(out.header.particleCount) * sizeof(Confetti);
+    if (sizeof(SnapshotHeader) + snakeBytes + particleBytes != rawSize) return false;
+
+    const Uint8* snakeData = headerBytes + sizeof(SnapshotHeader);
+    const Uint8* particleData = snakeData + snakeBytes;
+
+    out.snake.resize(out.header.snakeRunCount);
+    out.particles.resize(out.header.particleCount);
+    if (snakeBytes) std::memcpy(out.snake.data(), snakeData, snakeBytes);
+    if (particleBytes) std::memcpy(out.particles.data(), particleData, particleBytes);
+
+    if (base) {
+        xorAligned(reinterpret_cast<Uint8*>(out.snake.data()), out.header.snakeFirstRun, out.snake.size(), base->snake, base->header.snakeFirstRun);
+        xorAligned(reinterpret_cast<Uint8*>(out.particles.data()), 0, out.particles.size(), base->particles, 0);
+    }
+    return true;
+}
+
+SnapshotRing::SnapshotRing(size_t byteCapacity, size_t maxRecords)
+    : storage(byteCapacity),
+    records(maxRecords),
+    firstRecord(0),
+    recordCount(0),
+    usedBytes(0) {
+}
+
+void SnapshotRing::push(const std::vector<Uint8>& record) {
+    if (record.size() > storage.size()) return;
+
+    size_t offset = 0;
+    if (recordCount > 0) {
+        const Record& last = recordAt(recordCount - 1);
+        offset = last.offset + last.size;
+    }
+    if (offset + record.size() > storage.size()) {
+        // Wrapping around: everything between the write position and the end
+        // of the buffer is older than what sits at the front.
+        while (recordCount > 0 && recordAt(0).offset >= offset) dropOldest();
+        offset = 0;
+    }
+
+    // Past the wrap point the records ahead of the write position are always
+    // the oldest, so dropping from the front frees the space we need.
+    while (recordCount > 0) {
+        const Record& oldest = recordAt(0);
+        bool overlaps = oldest.offset < offset + record.size() && offset < oldest.offset + oldest.size;
+        if (!overlaps && recordCount < records.size()) break;
+        dropOldest();
+    }
+
+    std::memcpy(storage.data() + offset, record.data(), record.size());
+    records[(firstRecord + recordCount) % records.size()] = { offset, record.size() };
+    recordCount++;
+    usedBytes += record.size();
+}
+
+const Uint8* SnapshotRing::newest(size_t& size) const {
+    if (recordCount == 0) return nullptr;
+    const Record& record = recordAt(recordCount - 1);
+    size = record.size;
+    return storage.data() + record.offset;
+}
+
+void SnapshotRing::popNewest() {
+    if (recordCount == 0) return;
+    usedBytes -= recordAt(recordCount - 1).size;
+    recordCount--;
+}
+
+void SnapshotRing::dropOldest() {
+    usedBytes -= recordAt(0).size;
+    firstRecord = (firstRecord + 1) % records.size();
+    recordCount--;
+}
+
+void SnapshotRing::clear() {
+    firstRecord = 0;
+    recordCount = 0;
+    usedBytes = 0;
+}
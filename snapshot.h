@@ -0,0 +1,95 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <SDL.h>
+#include <cstddef>
+#include <vector>
+#include "game_types.h"
+#include "snake_body.h"
+
+// Fixed-size part of a snapshot. Times are stored relative to the capture
+// moment so a restored game continues from where it was saved.
+struct SnapshotHeader {
+    Uint32 magic;
+    Uint32 version;
+
+    Sint32 snakeGameActive;
+    Sint32 gameOver;
+    Sint32 isPaused;
+    Sint32 currentMode;
+    Sint32 snakeDirection;
+    Sint32 snakeSpeed;
+    Sint32 score;
+    Sint32 timer;
+    Sint32 foodGoal;
+    Sint32 foodX, foodY;
+    Uint32 msUntilCountdownTick;
+    Uint32 msSinceSnakeMove;
+
+    Sint32 showConfetti;
+    Uint32 msUntilConfettiEnd;
+
+    Sint32 gravityMode;
+    Sint32 rectX, rectY;
+    float velocityY;
+    float gravitySpeed;
+    float gravityAcceleration;
+    Sint32 isOnGround;
+
+    Sint32 worldMode;       // world chunks are not captured, only the flag
+    Uint32 reserved;        // always 0; aligns snakeFirstRun without hidden padding
+
+    Uint64 snakeFirstRun;   // run index of snake[0], used to align deltas
+    Uint32 snakeRunCount;
+    Uint32 particleCount;
+};
+
+// The header is stored and XOR-delta'd as raw bytes. With no padding, every
+// byte belongs to a member that "= {}" clears, so equal states encode
+// identically.
+static_assert(offsetof(SnapshotHeader, snakeFirstRun) == offsetof(SnapshotHeader, reserved) + sizeof(Uint32) &&
+    sizeof(SnapshotHeader) == offsetof(SnapshotHeader, particleCount) + sizeof(Uint32), "SnapshotHeader must not contain padding");
+
+struct Snapshot {
+    SnapshotHeader header;
+    std::vector<SnakeRun> snake;      // tail to head
+    std::vector<Confetti> particles;
+};
+
+// Encodes target as an XOR delta against base (or as a keyframe when base is
+// null), then run-length encodes the zero bytes. The snake section is aligned
+// by run index, so a snake that moved by one step costs a few bytes.
+void encodeSnapshot(const Snapshot& target, const Snapshot* base, std::vector<Uint8>& scratch, std::vector<Uint8>& out);
+bool decodeSnapshot(const Uint8* data, size_t size, const Snapshot* base, std::vector<Uint8>& scratch, Snapshot& out);
+
+// Memory-bounded LIFO of encoded snapshots. Records live in one circular byte
+// buffer; when it is full the oldest records are dropped.
+class SnapshotRing {
+public:
+    explicit SnapshotRing(size_t byteCapacity = 8 * 1024 * 1024, size_t maxRecords = 4096);
+
+    void push(const std::vector<Uint8>& record);
+    const Uint8* newest(size_t& size) const;
+    void popNewest();
+    void clear();
+
+    size_t count() const { return recordCount; }
+    size_t bytesUsed() const { return usedBytes; }
+
+private:
+    struct Record {
+        size_t offset;
+        size_t size;
+    };
+
+    const Record& recordAt(size_t index) const { return records[(firstRecord + index) % records.size()]; }
+    void dropOldest();
+
+    std::vector<Uint8> storage;
+    std::vector<Record> records;
+    size_t firstRecord;
+    size_t recordCount;
+    size_t usedBytes;
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,228 @@
+#include "soft_raster.h"
+#include "log.h"
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RASTER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define RASTER_TARGET_AVX
+#else
+#define RASTER_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+namespace {
+    void fillSpanScalar(Uint32* destination, int count, Uint32 color) {
+        std::fill_n(destination, count, color);
+    }
+
+#ifdef RASTER_X86
+    void fillSpanSSE2(Uint32* destination, int count, Uint32 color) {
+        __m128i value = _mm_set1_epi32(static_cast<int>(color));
+        int i = 0;
+        for (; i + 4 <= count; i += 4) _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), value);
+        for (; i < count; i++) destination[i] = color;
+    }
+
+    RASTER_TARGET_AVX void fillSpanAVX(Uint32* destination, int count, Uint32 color) {
+        __m256i value = _mm256_set1_epi32(static_cast<int>(color));
+        int i = 0;
+        for (; i + 8 <= count; i += 8) _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), value);
+        for (; i < count; i++) destination[i] = color;
+    }
+#endif
+
+    Uint32 packColor(SDL_Color color) {
+        return (0xFFu << 24) | (static_cast<Uint32>(color.r) << 16) | (static_cast<Uint32>(color.g) << 8) | color.b;
+    }
+}
+
+SoftRasterizer::SoftRasterizer()
+    : renderer(nullptr),
+    texture(nullptr),
+    width(0),
+    height(0),
+    clearPixel(0),
+    fillSpan(fillSpanScalar),
+    spanName("scalar"),
+    pixels(nullptr),
+    pitch(0),
+    nextTile(0),
+    generation(0),
+    busyWorkers(0),
+    stopping(false) {
+}
+
+SoftRasterizer::~SoftRasterizer() {
+    close();
+}
+
+bool SoftRasterizer::open(SDL_Renderer* target, int threads) {
+    if (renderer) return true;
+    renderer = target;
+
+#ifdef RASTER_X86
+    if (SDL_HasAVX()) {
+        fillSpan = fillSpanAVX;
+        spanName = "AVX";
+    }
+    else if (SDL_HasSSE2()) {
+        fillSpan = fillSpanSSE2;
+        spanName = "SSE2";
+    }
+#endif
+
+    if (threads <= 0) threads = std::min(8, SDL_GetCPUCount());
+    stopping = false;
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(&SoftRasterizer::workerLoop, this);
+    }
+    LOG_INFO("Software rasterizer: {} span fills, {} threads", spanName, threadCount());
+    return true;
+}
+
+void SoftRasterizer::close() {
+    if (!renderer) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+
+    for (const auto& overlay : overlays) {
+        if (overlay.destroyAfter) SDL_DestroyTexture(overlay.texture);
+    }
+    overlays.clear();
+    if (texture) SDL_DestroyTexture(texture);
+    texture = nullptr;
+    width = height = 0;
+    renderer = nullptr;
+}
+
+void SoftRasterizer::beginFrame(int frameWidth, int frameHeight, SDL_Color clearColor) {
+    fills.clear();
+    ensureTexture(frameWidth, frameHeight);
+    clearPixel = packColor(clearColor);
+    for (auto& tile : tileFills) tile.clear();
+}
+
+void SoftRasterizer::fillRect(const SDL_Rect& rect, SDL_Color color) {
+    Fill fill;
+    fill.x0 = std::max(0, rect.x);
+    fill.y0 = std::max(0, rect.y);
+    fill.x1 = std::min(width, rect.x + rect.w);
+    fill.y1 = std::min(height, rect.y + rect.h);
+    if (fill.x0 >= fill.x1 || fill.y0 >= fill.y1) return;
+    fill.color = packColor(color);
+
+    Uint32 index = static_cast<Uint32>(fills.size());
+    fills.push_back(fill);
+    int lastTile = (fill.y1 - 1) / TILE_ROWS;
+    for (int tile = fill.y0 / TILE_ROWS; tile <= lastTile; tile++) {
+        tileFills[tile].push_back(index);
+    }
+}
+
+void SoftRasterizer::fillRects(const SDL_Rect* rects, int count, SDL_Color color) {
+    for (int i = 0; i < count; i++) fillRect(rects[i], color);
+}
+
+void SoftRasterizer::copyTexture(SDL_Texture* texture, const SDL_Rect& destination, bool destroyAfter, const SDL_Rect* source) {
+    overlays.push_back({ texture, source ? *source : SDL_Rect{ 0, 0, 0, 0 }, destination, destroyAfter });
+}
+
+void SoftRasterizer::endFrame() {
+    if (texture) {
+        void* lockedPixels = nullptr;
+        if (SDL_LockTexture(texture, nullptr, &lockedPixels, &pitch) == 0) {
+            pixels = static_cast<Uint8*>(lockedPixels);
+            rasterizeTiles();
+            SDL_UnlockTexture(texture);
+            SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+        }
+        else {
+            LOG_ERROR("Rasterizer could not lock its texture: {}", SDL_GetError());
+        }
+    }
+
+    for (const auto& overlay : overlays) {
+        SDL_RenderCopy(renderer, overlay.texture, overlay.source.w > 0 ? &overlay.source : nullptr, &overlay.destination);
+        if (overlay.destroyAfter) SDL_DestroyTexture(overlay.texture);
+    }
+    overlays.clear();
+}
+
+bool SoftRasterizer::ensureTexture(int frameWidth, int frameHeight) {
+    if (texture && frameWidth == width && frameHeight == height) return true;
+    if (texture) SDL_DestroyTexture(texture);
+
+    width = frameWidth;
+    height = frameHeight;
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (!texture) {
+        LOG_ERROR("Rasterizer texture could not be created: {}", SDL_GetError());
+        width = height = 0;
+    }
+    tileFills.resize((height + TILE_ROWS - 1) / TILE_ROWS);
+    return texture != nullptr;
+}
+
+void SoftRasterizer::rasterizeTiles() {
+    nextTile.store(0);
+    if (!workers.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        busyWorkers = static_cast<int>(workers.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    // The main thread takes tiles too, then waits for the stragglers.
+    int tileCount = static_cast<int>(tileFills.size());
+    for (int tile = nextTile.fetch_add(1); tile < tileCount; tile = nextTile.fetch_add(1)) {
+        rasterizeTile(tile);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busyWorkers == 0; });
+}
+
+void SoftRasterizer::rasterizeTile(int tile) {
+    int tileY0 = tile * TILE_ROWS;
+    int tileY1 = std::min(height, tileY0 + TILE_ROWS);
+
+    for (int y = tileY0; y < tileY1; y++) {
+        fillSpan(reinterpret_cast<Uint32*>(pixels + static_cast<size_t>(y) * pitch), width, clearPixel);
+    }
+    for (Uint32 index : tileFills[tile]) {
+        const Fill& fill = fills[index];
+        int y0 = std::max(fill.y0, tileY0);
+        int y1 = std::min(fill.y1, tileY1);
+        for (int y = y0; y < y1; y++) {
+            Uint32* row = reinterpret_cast<Uint32*>(pixels + static_cast<size_t>(y) * pitch);
+            fillSpan(row + fill.x0, fill.x1 - fill.x0, fill.color);
+        }
+    }
+}
+
+void SoftRasterizer::workerLoop() {
+    Uint64 seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+
+        int tileCount = static_cast<int>(tileFills.size());
+        for (int tile = nextTile.fetch_add(1); tile < tileCount; tile = nextTile.fetch_add(1)) {
+            rasterizeTile(tile);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0) done.notify_one();
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include <SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// CPU rasterizer for solid, opaque rectangle fills. Fills are recorded during
+// the frame, binned into horizontal tiles, rasterized across worker threads
+// with SSE2/AVX span fills straight into a streaming texture, and drawn with
+// one SDL_RenderCopy. Textures queued with copyTexture() (text) go on top.
+class SoftRasterizer {
+public:
+    SoftRasterizer();
+    ~SoftRasterizer();
+
+    SoftRasterizer(const SoftRasterizer&) = delete;
+    SoftRasterizer& operator=(const SoftRasterizer&) = delete;
+
+    // threads = 0 uses one per CPU core, up to 8.
+    bool open(SDL_Renderer* target, int threads);
+    void close();
+    bool isOpen() const { return renderer != nullptr; }
+
+    void beginFrame(int width, int height, SDL_Color clearColor);
+    void fillRect(const SDL_Rect& rect, SDL_Color color);
+    void fillRects(const SDL_Rect* rects, int count, SDL_Color color);
+    // source picks part of the texture; null copies all of it.
+    void copyTexture(SDL_Texture* texture, const SDL_Rect& destination, bool destroyAfter = false, const SDL_Rect* source = nullptr);
+    void endFrame();
+
+    const char* spanFillName() const { return spanName; }
+    int threadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+private:
+    struct Fill {
+        int x0, y0, x1, y1;
+        Uint32 color;
+    };
+
+    struct Overlay {
+        SDL_Texture* texture;
+        SDL_Rect source;            // w == 0: the whole texture
+        SDL_Rect destination;
+        bool destroyAfter;
+    };
+
+    static const int TILE_ROWS = 32;
+
+    bool ensureTexture(int width, int height);
+    void rasterizeTiles();
+    void rasterizeTile(int tile);
+    void workerLoop();
+
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+    int width, height;
+    Uint32 clearPixel;
+
+    std::vector<Fill> fills;
+    std::vector<std::vector<Uint32>> tileFills;   // fill indices per tile, in draw order
+    std::vector<Overlay> overlays;
+
+    void (*fillSpan)(Uint32* destination, int count, Uint32 color);
+    const char* spanName;
+
+    // Frame being rasterized, shared with the workers.
+    Uint8* pixels;
+    int pitch;
+    std::atomic<int> nextTile;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    Uint64 generation;
+    int busyWorkers;
+    bool stopping;
+};
+
+#endif // SOFT_RASTER_H
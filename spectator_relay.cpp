@@ -0,0 +1,437 @@
+#include "spectator_relay.h"
+#include "log.h"
+#include "snake_body.h"
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <ctime>
+#endif
+
+namespace {
+    double threadCpuMs() {
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0.0;
+        ULARGE_INTEGER k, u;
+        k.LowPart = kernel.dwLowDateTime;
+        k.HighPart = kernel.dwHighDateTime;
+        u.LowPart = user.dwLowDateTime;
+        u.HighPart = user.dwHighDateTime;
+        return (k.QuadPart + u.QuadPart) / 10000.0;   // 100 ns units
+#else
+        timespec now;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0.0;
+        return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+    }
+
+    const Uint8 KEYFRAME_FLAG = 1;
+
+    void writeUint32(Uint8* out, Uint32 value) {
+        out[0] = static_cast<Uint8>(value);
+        out[1] = static_cast<Uint8>(value >> 8);
+        out[2] = static_cast<Uint8>(value >> 16);
+        out[3] = static_cast<Uint8>(value >> 24);
+    }
+
+    Uint32 readUint32(const Uint8* in) {
+        return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<Uint32>(in[3]) << 24);
+    }
+}
+
+SpectatorRelay::SpectatorRelay()
+    : listener(NO_SOCKET),
+    boundPort(0),
+    hasPrevious(false),
+    tickIndex(0),
+    stopping(false),
+    subscribers(0),
+    ticksPublished(0),
+    bytesSent(0),
+    joined(0),
+    dropped(0),
+    resyncs(0),
+    relayCpuMs(0.0) {
+}
+
+SpectatorRelay::~SpectatorRelay() {
+    close();
+}
+
+bool SpectatorRelay::open(Uint16 port, bool loopbackOnly) {
+    if (isOpen()) return true;
+    if (!netStartup()) {
+        LOG_ERROR("Spectator relay: socket library could not start");
+        return false;
+    }
+    listener = netListen(port, loopbackOnly, boundPort);
+    if (listener == NO_SOCKET) {
+        LOG_ERROR("Spectator relay: could not listen on port {}", port);
+        netShutdown();
+        return false;
+    }
+
+    hasPrevious = false;
+    tickIndex = 0;
+    stopping = false;
+    relayThread = std::thread(&SpectatorRelay::relayLoop, this);
+    LOG_INFO("Spectator relay listening on port {}", boundPort);
+    return true;
+}
+
+void SpectatorRelay::close() {
+    if (!isOpen()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    relayThread.join();
+
+    netClose(listener);
+    listener = NO_SOCKET;
+    for (TickBuffer* buffer : inbox) delete buffer;
+    for (TickBuffer* buffer : pool) delete buffer;
+    inbox.clear();
+    pool.clear();
+    netShutdown();
+}
+
+void SpectatorRelay::publish(const Snapshot& snapshot) {
+    if (!isOpen()) return;
+
+    TickBuffer* buffer = acquireBuffer();
+    buffer->refs = 1;
+    buffer->keyframe = !hasPrevious || tickIndex % KEYFRAME_INTERVAL == 0;
+    encodeSnapshot(snapshot, buffer->keyframe ? nullptr : &previous, scratch, buffer->payload);
+    writeUint32(buffer->header, static_cast<Uint32>(buffer->payload.size()));
+    writeUint32(buffer->header + 4, tickIndex);
+    buffer->header[8] = buffer->keyframe ? KEYFRAME_FLAG : 0;
+
+    previous = snapshot;
+    hasPrevious = true;
+    tickIndex++;
+    ticksPublished++;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inbox.push_back(buffer);
+    }
+    wake.notify_one();
+}
+
+SpectatorRelay::Stats SpectatorRelay::stats() const {
+    Stats result;
+    result.ticksPublished = ticksPublished.load();
+    result.bytesSent = bytesSent.load();
+    result.subscribersJoined = joined.load();
+    result.subscribersDropped = dropped.load();
+    result.resyncs = resyncs.load();
+    result.relayCpuMs = relayCpuMs.load();
+    return result;
+}
+
+SpectatorRelay::TickBuffer* SpectatorRelay::acquireBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pool.empty()) {
+            TickBuffer* buffer = pool.back();
+            pool.pop_back();
+            return buffer;
+        }
+    }
+    return new TickBuffer();
+}
+
+void SpectatorRelay::releaseBuffer(TickBuffer* buffer) {
+    if (--buffer->refs > 0) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    pool.push_back(buffer);
+}
+
+void SpectatorRelay::relayLoop() {
+    std::vector<TickBuffer*> incoming;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(5), [this] { return stopping || !inbox.empty(); });
+            if (stopping) break;
+            incoming.swap(inbox);
+        }
+
+        acceptSubscribers();
+
+        for (TickBuffer* buffer : incoming) {
+            if (buffer->keyframe) {
+                for (TickBuffer* old : sinceKeyframe) releaseBuffer(old);
+                sinceKeyframe.clear();
+            }
+            buffer->refs++;
+            sinceKeyframe.push_back(buffer);
+
+            for (Subscriber* client : clients) {
+                enqueue(*client, buffer);
+            }
+            releaseBuffer(buffer);   // the publisher's reference
+        }
+        incoming.clear();
+
+        for (size_t i = 0; i < clients.size();) {
+            if (flush(*clients[i])) {
+                i++;
+                continue;
+            }
+            Subscriber* client = clients[i];
+            netClose(client->socket);
+            client->sentBytes = 0;
+            dropQueue(*client);
+            delete client;
+            clients[i] = clients.back();
+            clients.pop_back();
+            subscribers--;
+            dropped++;
+        }
+        relayCpuMs = threadCpuMs();
+    }
+
+    for (Subscriber* client : clients) {
+        netClose(client->socket);
+        client->sentBytes = 0;
+        dropQueue(*client);
+        delete client;
+    }
+    clients.clear();
+    subscribers = 0;
+    for (TickBuffer* buffer : sinceKeyframe) releaseBuffer(buffer);
+    sinceKeyframe.clear();
+}
+
+void SpectatorRelay::acceptSubscribers() {
+    for (;;) {
+        NetSocket s = netAccept(listener);
+        if (s == NO_SOCKET) return;
+
+        Subscriber* client = new Subscriber();
+        client->socket = s;
+        client->head = 0;
+        client->count = 0;
+        client->sentBytes = 0;
+        client->synced = false;
+        // Late join: start from the latest keyframe and catch up from there.
+        for (TickBuffer* buffer : sinceKeyframe) {
+            enqueue(*client, buffer);
+        }
+        clients.push_back(client);
+        subscribers++;
+        joined++;
+    }
+}
+
+void SpectatorRelay::enqueue(Subscriber& subscriber, TickBuffer* buffer) {
+    if (!subscriber.synced) {
+        if (!buffer->keyframe) return;
+        subscriber.synced = true;
+    }
+    if (subscriber.count == MAX_QUEUED_TICKS) {
+        // Too far behind to catch up tick by tick: skip to the next keyframe.
+        dropQueue(subscriber);
+        resyncs++;
+        if (!buffer->keyframe) {
+            subscriber.synced = false;
+            return;
+        }
+    }
+    buffer->refs++;
+    subscriber.queue[(subscriber.head + subscriber.count) % MAX_QUEUED_TICKS] = buffer;
+    subscriber.count++;
+}
+
+// Sends as much of the backlog as the socket takes in one gathered write.
+// Returns false when the subscriber is gone.
+bool SpectatorRelay::flush(Subscriber& subscriber) {
+    while (subscriber.count > 0) {
+        NetSlice slices[NET_MAX_SLICES];
+        int sliceCount = 0;
+        size_t skip = subscriber.sentBytes;
+        for (int i = 0; i < subscriber.count && sliceCount + 2 <= NET_MAX_SLICES; i++) {
+            const TickBuffer* buffer = subscriber.queue[(subscriber.head + i) % MAX_QUEUED_TICKS];
+            if (skip < FRAME_HEADER_BYTES) {
+                slices[sliceCount++] = { buffer->header + skip, FRAME_HEADER_BYTES - skip };
+                skip = 0;
+            }
+            else {
+                skip -= FRAME_HEADER_BYTES;
+            }
+            if (buffer->payload.size() > skip) {
+                slices[sliceCount++] = { buffer->payload.data() + skip, buffer->payload.size() - skip };
+            }
+            skip = 0;
+        }
+
+        long sent = netSend(subscriber.socket, slices, sliceCount);
+        if (sent < 0) return false;
+        if (sent == 0) return true;
+        bytesSent += static_cast<Uint64>(sent);
+
+        size_t remaining = subscriber.sentBytes + static_cast<size_t>(sent);
+        while (subscriber.count > 0) {
+            TickBuffer* buffer = subscriber.queue[subscriber.head];
+            size_t frameBytes = FRAME_HEADER_BYTES + buffer->payload.size();
+            if (remaining < frameBytes) break;
+            remaining -= frameBytes;
+            releaseBuffer(buffer);
+            subscriber.head = (subscriber.head + 1) % MAX_QUEUED_TICKS;
+            subscriber.count--;
+        }
+        subscriber.sentBytes = remaining;
+    }
+    return true;
+}
+
+// Releases the backlog, except a frame that is half sent: cutting it would
+// corrupt the stream.
+void SpectatorRelay::dropQueue(Subscriber& subscriber) {
+    int keep = subscriber.sentBytes > 0 && subscriber.count > 0 ? 1 : 0;
+    for (int i = keep; i < subscriber.count; i++) {
+        releaseBuffer(subscriber.queue[(subscriber.head + i) % MAX_QUEUED_TICKS]);
+    }
+    subscriber.count = keep;
+}
+
+int runSpectatorBenchmark(int spectators) {
+    const int ticks = 300;
+    const int tickRate = 60;
+
+    if (!netStartup()) return 1;
+    SpectatorRelay relay;
+    if (!relay.open(0, true)) {
+        netShutdown();
+        return 1;
+    }
+
+    std::vector<NetSocket> clients;
+    clients.reserve(spectators);
+    for (int i = 0; i < spectators; i++) {
+        NetSocket s = netConnectLoopback(relay.port());
+        if (s == NO_SOCKET) {
+            LOG_WARN("Client {} could not connect (open file limit?)", i);
+            break;
+        }
+        clients.push_back(s);
+    }
+    auto waitUntil = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (relay.subscriberCount() < static_cast<int>(clients.size()) && std::chrono::steady_clock::now() < waitUntil) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Clients drain their sockets on one thread; the first one decodes every
+    // frame so the stream itself is checked too.
+    std::atomic<bool> done(false);
+    std::atomic<Uint64> bytesReceived(0);
+    Snapshot decoded;
+    std::atomic<Uint32> decodedTicks(0);
+    std::atomic<bool> decodeFailed(false);
+    std::thread reader([&] {
+        std::vector<Uint8> chunk(64 * 1024);
+        std::vector<Uint8> stream;
+        std::vector<Uint8> decodeScratch;
+        Snapshot next;
+        bool haveBase = false;
+        while (!done) {
+            bool any = false;
+            for (size_t i = 0; i < clients.size(); i++) {
+                long got;
+                while ((got = netReceive(clients[i], chunk.data(), chunk.size())) > 0) {
+                    any = true;
+                    bytesReceived += static_cast<Uint64>(got);
+                    if (i == 0) stream.insert(stream.end(), chunk.begin(), chunk.begin() + got);
+                }
+            }
+
+            size_t offset = 0;
+            while (stream.size() - offset >= SpectatorRelay::FRAME_HEADER_BYTES) {
+                Uint32 payloadSize = readUint32(stream.data() + offset);
+                size_t frameSize = SpectatorRelay::FRAME_HEADER_BYTES + payloadSize;
+                if (stream.size() - offset < frameSize) break;
+                bool keyframe = (stream[offset + 8] & KEYFRAME_FLAG) != 0;
+                const Uint8* payload = stream.data() + offset + SpectatorRelay::FRAME_HEADER_BYTES;
+                if ((!keyframe && !haveBase) ||
+                    !decodeSnapshot(payload, payloadSize, keyframe ? nullptr : &decoded, decodeScratch, next)) {
+                    decodeFailed = true;
+                }
+                else {
+                    std::swap(decoded, next);
+                    haveBase = true;
+                    decodedTicks++;
+                }
+                offset += frameSize;
+            }
+            stream.erase(stream.begin(), stream.begin() + offset);
+            if (!any) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    // A snake circling a square, moving one cell per tick.
+    SnakeBody body;
+    body.reset(400, 400, RIGHT);
+    static const Direction turns[4] = { RIGHT, DOWN, LEFT, UP };
+    int step = 0;
+    auto advance = [&](bool grow) {
+        body.extendHead(turns[(step / 60) % 4]);
+        if (!grow) body.trimTail();
+        step++;
+    };
+    for (int i = 0; i < 200; i++) advance(true);
+
+    Snapshot published = {};
+    published.header.snakeGameActive = 1;
+    published.header.currentMode = MODE_2;
+    auto start = std::chrono::steady_clock::now();
+    double cpuBefore = relay.stats().relayCpuMs;
+    double publishMs = 0.0;
+    for (int tick = 0; tick < ticks; tick++) {
+        advance(tick % 10 == 0);
+        published.header.score = tick / 10;
+        published.header.snakeDirection = turns[(step / 60) % 4];
+        published.header.snakeFirstRun = body.firstRunIndex();
+        body.copyRuns(published.snake);
+
+        auto publishStart = std::chrono::steady_clock::now();
+        relay.publish(published);
+        publishMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - publishStart).count();
+        std::this_thread::sleep_until(start + std::chrono::microseconds(1000000LL * (tick + 1) / tickRate));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    waitUntil = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (decodedTicks < static_cast<Uint32>(ticks) && !decodeFailed && std::chrono::steady_clock::now() < waitUntil) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    SpectatorRelay::Stats stats = relay.stats();
+    done = true;
+    reader.join();
+    relay.close();
+    for (NetSocket s : clients) netClose(s);
+    netShutdown();
+
+    bool matches = !clients.empty() && decodedTicks == static_cast<Uint32>(ticks) && !decodeFailed &&
+        decoded.header.score == published.header.score && decoded.snake.size() == published.snake.size() &&
+        std::memcmp(decoded.snake.data(), published.snake.data(), published.snake.size() * sizeof(SnakeRun)) == 0;
+
+    double cpuMs = stats.relayCpuMs - cpuBefore;
+    double perThousand = clients.empty() ? 0.0 : cpuMs / seconds * 1000.0 / clients.size();
+    LOG_INFO("Spectator relay: {} spectators, {} ticks at {}/s\n"
+        "  publish {} us per tick, {} KB sent, {} KB received\n"
+        "  relay thread CPU {} ms in {} s ({}% of a core), {} ms CPU per second per 1,000 spectators\n"
+        "  {} dropped, {} resyncs; client 0 decoded {}/{} ticks, final state {}",
+        clients.size(), ticks, tickRate,
+        publishMs / ticks * 1000.0, stats.bytesSent / 1024, bytesReceived.load() / 1024,
+        cpuMs, seconds, cpuMs / seconds / 10.0, perThousand,
+        stats.subscribersDropped, stats.resyncs, decodedTicks.load(), ticks, matches ? "matches" : "DIFFERS");
+    return matches ? 0 : 1;
+}
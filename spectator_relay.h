@@ -0,0 +1,121 @@
+#ifndef SPECTATOR_RELAY_H
+#define SPECTATOR_RELAY_H
+
+#include <SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "net_socket.h"
+#include "snapshot.h"
+
+// Streams a live match to TCP spectators. Each tick is encoded once on the
+// publishing thread (a snapshot delta against the previous tick, or a
+// keyframe every KEYFRAME_INTERVAL ticks) into a shared, reference-counted
+// buffer. The relay thread queues that same buffer on every subscriber and
+// sends each subscriber's backlog with one scatter-gather write, so fan-out
+// never copies tick data.
+//
+// Wire format, little-endian: per tick a 9-byte frame header
+// { Uint32 payloadSize, Uint32 tick, Uint8 flags } followed by the output of
+// encodeSnapshot(). flags bit 0 marks a keyframe; every other frame decodes
+// against the snapshot of the frame before it. Late joiners are sent the
+// latest keyframe and the deltas since, then follow live.
+class SpectatorRelay {
+public:
+    static const int KEYFRAME_INTERVAL = 60;
+    static const int MAX_QUEUED_TICKS = 256;   // a subscriber further behind resyncs at the next keyframe
+    static const int FRAME_HEADER_BYTES = 9;
+
+    struct Stats {
+        Uint64 ticksPublished;
+        Uint64 bytesSent;
+        Uint64 subscribersJoined;
+        Uint64 subscribersDropped;   // disconnected or send error
+        Uint64 resyncs;              // fell too far behind and skipped to a keyframe
+        double relayCpuMs;           // CPU time used by the relay thread
+    };
+
+    SpectatorRelay();
+    ~SpectatorRelay();
+
+    SpectatorRelay(const SpectatorRelay&) = delete;
+    SpectatorRelay& operator=(const SpectatorRelay&) = delete;
+
+    // port 0 picks a free port; see port().
+    bool open(Uint16 port, bool loopbackOnly = false);
+    void close();
+    bool isOpen() const { return relayThread.joinable(); }
+    Uint16 port() const { return boundPort; }
+
+    // Main thread, once per simulation tick.
+    void publish(const Snapshot& snapshot);
+
+    int subscriberCount() const { return subscribers.load(); }
+    Stats stats() const;
+
+private:
+    // One encoded tick. Reference counts only change on the relay thread;
+    // the last release returns the buffer to the pool for reuse.
+    struct TickBuffer {
+        int refs;
+        bool keyframe;
+        Uint8 header[FRAME_HEADER_BYTES];
+        std::vector<Uint8> payload;
+    };
+
+    struct Subscriber {
+        NetSocket socket;
+        TickBuffer* queue[MAX_QUEUED_TICKS];
+        int head;
+        int count;
+        size_t sentBytes;           // of queue[head]
+        bool synced;                // false: waiting for a keyframe
+    };
+
+    TickBuffer* acquireBuffer();
+    void releaseBuffer(TickBuffer* buffer);
+    void relayLoop();
+    void acceptSubscribers();
+    void enqueue(Subscriber& subscriber, TickBuffer* buffer);
+    bool flush(Subscriber& subscriber);
+    void dropQueue(Subscriber& subscriber);
+
+    NetSocket listener;
+    Uint16 boundPort;
+    std::thread relayThread;
+
+    // Publisher side
+    Snapshot previous;
+    bool hasPrevious;
+    Uint32 tickIndex;
+    std::vector<Uint8> scratch;
+
+    // Handoff from publisher to relay thread
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<TickBuffer*> inbox;
+    std::vector<TickBuffer*> pool;
+    bool stopping;
+
+    // Relay thread only
+    std::vector<Subscriber*> clients;
+    std::vector<TickBuffer*> sinceKeyframe;   // latest keyframe and the deltas after it
+
+    std::atomic<int> subscribers;
+    std::atomic<Uint64> ticksPublished;
+    std::atomic<Uint64> bytesSent;
+    std::atomic<Uint64> joined;
+    std::atomic<Uint64> dropped;
+    std::atomic<Uint64> resyncs;
+    std::atomic<double> relayCpuMs;
+};
+
+// Loopback load test: connects `spectators` local TCP clients, streams a
+// moving snake for a few seconds at 60 ticks per second, checks that one
+// client decodes every tick, and reports relay CPU per 1,000 spectators.
+// Returns the process exit code.
+int runSpectatorBenchmark(int spectators);
+
+#endif // SPECTATOR_RELAY_H
@@ -0,0 +1,332 @@
+#include "stall_watchdog.h"
+#include "log.h"
+#include "profile_zone.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <dbghelp.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <execinfo.h>
+#endif
+
+namespace {
+    const int SIGNAL_WAIT_MS = 100;     // POSIX: how long to wait for the handler
+    const int SIGNAL_FRAMES = 2;        // the handler itself and the kernel's return trampoline
+
+    double msBetween(Uint64 from, Uint64 to, Uint64 frequency) {
+        return (to - from) * 1000.0 / frequency;
+    }
+
+#ifndef _WIN32
+    // The handler runs on the watched thread and only calls backtrace(),
+    // which was primed in start() so it does not load anything on first use.
+    // It takes the buffer, so a signal arriving after the wait gave up does
+    // nothing.
+    int signalMaxFrames = 0;
+    std::atomic<void**> signalFrames(nullptr);
+    std::atomic<int> signalFrameCount(-1);
+
+    void sampleSignalHandler(int) {
+        void** frames = signalFrames.exchange(nullptr, std::memory_order_acquire);
+        if (!frames) return;
+        int savedErrno = errno;
+        signalFrameCount.store(backtrace(frames, signalMaxFrames), std::memory_order_release);
+        errno = savedErrno;
+    }
+#endif
+}
+
+StallWatchdog::StallWatchdog()
+    : frequency(1),
+    thresholdMs(0.0),
+    stopping(false),
+    lastBeat(0),
+    beatFrame(0),
+    historyCount(0),
+    stalls(0),
+    worstMs(0.0),
+#ifdef _WIN32
+    watchedThread(nullptr),
+    symbolsLoaded(false) {
+#else
+    watchedThread(),
+    previousAction() {
+#endif
+    for (auto& frame : history) frame.store(0, std::memory_order_relaxed);
+}
+
+StallWatchdog::~StallWatchdog() {
+    stop();
+}
+
+bool StallWatchdog::start(double stallMs, const std::string& reportFile) {
+    if (isRunning() || stallMs <= 0.0) return false;
+    frequency = SDL_GetPerformanceFrequency();
+    thresholdMs = stallMs;
+    reportPath = reportFile;
+    lastBeat.store(0, std::memory_order_relaxed);
+    historyCount.store(0, std::memory_order_relaxed);
+
+#ifdef _WIN32
+    if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &watchedThread,
+        THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE, 0)) {
+        LOG_ERROR("Stall watchdog: could not open the main thread");
+        return false;
+    }
+#else
+    watchedThread = pthread_self();
+    void* warmUp[4];
+    backtrace(warmUp, 4);
+    struct sigaction action = {};
+    action.sa_handler = sampleSignalHandler;
+    action.sa_flags = SA_RESTART;      // interrupted system calls carry on
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR2, &action, &previousAction);
+#endif
+
+    ProfileZone::publishThisThread();
+    stopping = false;
+    watchdogThread = std::thread(&StallWatchdog::watchLoop, this);
+    LOG_INFO("Stall watchdog: reporting frames over {} ms to {}", thresholdMs, reportPath);
+    return true;
+}
+
+void StallWatchdog::stop() {
+    if (!isRunning()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    watchdogThread.join();
+
+#ifdef _WIN32
+    CloseHandle(watchedThread);
+    watchedThread = nullptr;
+    if (symbolsLoaded) {
+        SymCleanup(GetCurrentProcess());
+        symbolsLoaded = false;
+    }
+#else
+    // A sample signal can still be pending if the frame ended just as it was
+    // sent. Ignoring SIGUSR2 first discards it; only then is it safe to put
+    // back the old handler, which is usually the default (terminate).
+    signal(SIGUSR2, SIG_IGN);
+    sigaction(SIGUSR2, &previousAction, nullptr);
+#endif
+}
+
+StallWatchdog::Stats StallWatchdog::stats() const {
+    Stats result;
+    result.stalls = stalls.load();
+    result.worstMs = worstMs.load();
+    return result;
+}
+
+void StallWatchdog::watchLoop() {
+    // A few checks per threshold keep detection late by at most a quarter of it.
+    auto poll = std::chrono::milliseconds(std::max(2, std::min(50, static_cast<int>(thresholdMs / 4))));
+    Sample samples[MAX_SAMPLES];
+    Uint64 timeline[HISTORY_FRAMES];
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        wake.wait_for(lock, poll);
+        Uint64 beat = lastBeat.load(std::memory_order_acquire);
+        if (stopping || beat == 0 || msBetween(beat, SDL_GetPerformanceCounter(), frequency) < thresholdMs) continue;
+
+        // Stalled: sample once per threshold until the frame ends.
+        Uint32 frame = beatFrame.load(std::memory_order_relaxed);
+        int sampleCount = 0;
+        Uint64 end = beat;
+        while (!stopping) {
+            end = lastBeat.load(std::memory_order_acquire);
+            if (end != beat) break;
+            double elapsedMs = msBetween(beat, SDL_GetPerformanceCounter(), frequency);
+            if (sampleCount < MAX_SAMPLES && elapsedMs >= thresholdMs * (sampleCount + 1)) {
+                lock.unlock();
+                takeSample(samples[sampleCount++], elapsedMs);
+                lock.lock();
+            }
+            wake.wait_for(lock, poll);
+        }
+        if (end == beat) end = SDL_GetPerformanceCounter();    // stopped mid-stall
+        int timelineCount = copyTimeline(frame, timeline);
+
+        // The watchdog may notice the end a few frames late; the timeline has
+        // the exact figure.
+        double durationMs = msBetween(beat, end, frequency);
+        if (timelineCount > 0 && static_cast<Uint32>(timeline[timelineCount - 1] >> 32) == frame) {
+            durationMs = static_cast<Uint32>(timeline[timelineCount - 1]) / 1000.0;
+        }
+        stalls++;
+        if (durationMs > worstMs.load()) worstMs.store(durationMs);
+        lock.unlock();
+        writeReport(frame, durationMs, samples, sampleCount, timeline, timelineCount);
+        lock.lock();
+    }
+}
+
+void StallWatchdog::takeSample(Sample& sample, double atMs) {
+    sample.atMs = atMs;
+    sample.zone = ProfileZone::published();
+    sample.frameCount = captureStack(sample.frames, MAX_STACK_FRAMES);
+}
+
+#ifdef _WIN32
+// The watched thread is suspended for the walk, so nothing here may touch the
+// heap or any lock it could be holding: only raw unwinding into a fixed array.
+// Symbols are looked up after it resumes.
+int StallWatchdog::captureStack(void** frames, int maxFrames) {
+    if (SuspendThread(watchedThread) == static_cast<DWORD>(-1)) return 0;
+    CONTEXT context = {};
+    context.ContextFlags = CONTEXT_FULL;
+    int count = 0;
+    if (GetThreadContext(watchedThread, &context)) {
+#if defined(_M_X64)
+        while (count < maxFrames && context.Rip != 0) {
+            frames[count++] = reinterpret_cast<void*>(context.Rip);
+            DWORD64 imageBase = 0;
+            PRUNTIME_FUNCTION function = RtlLookupFunctionEntry(context.Rip, &imageBase, nullptr);
+            if (function) {
+                void* handlerData = nullptr;
+                DWORD64 establisherFrame = 0;
+                RtlVirtualUnwind(UNW_FLAG_NHANDLER, imageBase, context.Rip, function, &context, &handlerData, &establisherFrame, nullptr);
+            }
+            else {
+                // Leaf function: the return address is on top of the stack.
+                context.Rip = *reinterpret_cast<DWORD64*>(context.Rsp);
+                context.Rsp += 8;
+            }
+        }
+#else
+        // x86 frames are walked by frame pointer, which needs no tables.
+        STACKFRAME64 stackFrame = {};
+        stackFrame.AddrPC.Offset = context.Eip;
+        stackFrame.AddrPC.Mode = AddrModeFlat;
+        stackFrame.AddrFrame.Offset = context.Ebp;
+        stackFrame.AddrFrame.Mode = AddrModeFlat;
+        stackFrame.AddrStack.Offset = context.Esp;
+        stackFrame.AddrStack.Mode = AddrModeFlat;
+        while (count < maxFrames && StackWalk64(IMAGE_FILE_MACHINE_I386, GetCurrentProcess(), watchedThread, &stackFrame,
+            &context, nullptr, nullptr, nullptr, nullptr) && stackFrame.AddrPC.Offset != 0) {
+            frames[count++] = reinterpret_cast<void*>(static_cast<uintptr_t>(stackFrame.AddrPC.Offset));
+        }
+#endif
+    }
+    ResumeThread(watchedThread);
+    return count;
+}
+#else
+int StallWatchdog::captureStack(void** frames, int maxFrames) {
+    signalMaxFrames = maxFrames;
+    signalFrameCount.store(-1, std::memory_order_relaxed);
+    signalFrames.store(frames, std::memory_order_release);
+    if (pthread_kill(watchedThread, SIGUSR2) != 0) {
+        signalFrames.store(nullptr, std::memory_order_relaxed);
+        return 0;
+    }
+
+    auto giveUp = std::chrono::steady_clock::now() + std::chrono::milliseconds(SIGNAL_WAIT_MS);
+    int count;
+    while ((count = signalFrameCount.load(std::memory_order_acquire)) < 0 && std::chrono::steady_clock::now() < giveUp) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (count < 0) signalFrames.store(nullptr, std::memory_order_relaxed);
+    if (count <= SIGNAL_FRAMES) return 0;
+    std::memmove(frames, frames + SIGNAL_FRAMES, (count - SIGNAL_FRAMES) * sizeof(void*));
+    return count - SIGNAL_FRAMES;
+}
+#endif
+
+// Oldest first, ending with lastFrame. The game may already be a few frames
+// past it; those are left out.
+int StallWatchdog::copyTimeline(Uint32 lastFrame, Uint64* timeline) const {
+    Uint32 count = historyCount.load(std::memory_order_relaxed);
+    Uint32 oldest = count > static_cast<Uint32>(HISTORY_FRAMES) ? count - HISTORY_FRAMES : 0;
+    Uint32 last = count;
+    while (last > oldest && static_cast<Uint32>(history[(last - 1) % HISTORY_FRAMES].load(std::memory_order_relaxed) >> 32) > lastFrame) {
+        last--;
+    }
+    int copied = 0;
+    for (Uint32 i = oldest; i < last; i++) {
+        timeline[copied++] = history[i % HISTORY_FRAMES].load(std::memory_order_relaxed);
+    }
+    return copied;
+}
+
+void StallWatchdog::writeReport(Uint32 frame, double durationMs, const Sample* samples, int sampleCount,
+    const Uint64* timeline, int timelineCount) {
+    LOG_WARN("Frame {} stalled for {} ms, last in zone '{}'; details in {}", frame, durationMs,
+        sampleCount > 0 ? samples[sampleCount - 1].zone : "(not sampled)", reportPath);
+
+    std::ofstream file(reportPath, std::ios::app);
+    if (!file.is_open()) {
+        LOG_ERROR("Stall watchdog: could not write {}", reportPath);
+        return;
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line), "=== Frame %u took %.1f ms (threshold %.0f ms), %u ms after start\n",
+        frame, durationMs, thresholdMs, SDL_GetTicks());
+    file << line;
+
+#ifdef _WIN32
+    HANDLE process = GetCurrentProcess();
+    if (!symbolsLoaded) {
+        SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES);
+        symbolsLoaded = SymInitialize(process, nullptr, TRUE) != FALSE;
+    }
+#endif
+    for (int i = 0; i < sampleCount; i++) {
+        const Sample& sample = samples[i];
+        std::snprintf(line, sizeof(line), "Sample at +%.0f ms in zone '%s':\n", sample.atMs, sample.zone);
+        file << line;
+#ifdef _WIN32
+        for (int f = 0; f < sample.frameCount; f++) {
+            DWORD64 address = reinterpret_cast<DWORD64>(sample.frames[f]);
+            alignas(SYMBOL_INFO) char symbolBuffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME];
+            SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(symbolBuffer);
+            symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+            symbol->MaxNameLen = MAX_SYM_NAME;
+            DWORD64 offset = 0;
+            IMAGEHLP_LINE64 source = {};
+            source.SizeOfStruct = sizeof(source);
+            DWORD column = 0;
+            bool named = symbolsLoaded && SymFromAddr(process, address, &offset, symbol);
+            bool located = symbolsLoaded && SymGetLineFromAddr64(process, address, &column, &source);
+            std::snprintf(line, sizeof(line), "  #%-2d 0x%016llx %s+0x%llx", f, static_cast<unsigned long long>(address),
+                named ? symbol->Name : "?", static_cast<unsigned long long>(offset));
+            file << line;
+            if (located) file << " (" << source.FileName << ":" << source.LineNumber << ")";
+            file << "\n";
+        }
+#else
+        char** names = backtrace_symbols(sample.frames, sample.frameCount);
+        for (int f = 0; f < sample.frameCount; f++) {
+            file << "  #" << f << " " << (names ? names[f] : "?") << "\n";
+        }
+        std::free(names);
+#endif
+        if (sample.frameCount == 0) file << "  (stack not available)\n";
+    }
+
+    file << "Recent frames:\n";
+    for (int i = 0; i < timelineCount; i++) {
+        Uint64 entry = timeline[i];
+        double ms = static_cast<Uint32>(entry) / 1000.0;
+        std::snprintf(line, sizeof(line), "  frame %-8u %8.1f ms%s\n", static_cast<Uint32>(entry >> 32), ms,
+            ms >= thresholdMs ? "  <-- over threshold" : "");
+        file << line;
+    }
+    file << "\n";
+}
@@ -0,0 +1,106 @@
+#ifndef STALL_WATCHDOG_H
+#define STALL_WATCHDOG_H
+
+#include <SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
+
+// Catches frames that hang. The main loop calls heartbeat() once per
+// iteration, which costs a timer read and two relaxed stores. A watchdog
+// thread checks the last heartbeat a few times per threshold. When a frame
+// runs past the threshold, it samples the main thread's stack and profiler
+// zone, once per threshold, up to MAX_SAMPLES times. When the frame finally
+// ends it appends a report with the samples and a timeline of the frames
+// before it.
+//
+// Stacks come from suspending the thread and unwinding it (Windows), or from
+// a signal handler that calls backtrace() (elsewhere).
+class StallWatchdog {
+public:
+    static const int HISTORY_FRAMES = 60;
+    static const int MAX_SAMPLES = 4;
+    static const int MAX_STACK_FRAMES = 48;
+
+    struct Stats {
+        Uint64 stalls;
+        double worstMs;
+    };
+
+    StallWatchdog();
+    ~StallWatchdog();
+
+    StallWatchdog(const StallWatchdog&) = delete;
+    StallWatchdog& operator=(const StallWatchdog&) = delete;
+
+    // From the thread to watch, normally main. Reports are appended to reportFile.
+    bool start(double thresholdMs, const std::string& reportFile);
+    void stop();
+    bool isRunning() const { return watchdogThread.joinable(); }
+
+    // Watched thread, once per loop iteration.
+    void heartbeat(Uint32 frameIndex) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        Uint64 previous = lastBeat.load(std::memory_order_relaxed);
+        if (previous != 0) {
+            Uint64 micros = (now - previous) * 1000000 / frequency;
+            Uint32 slot = historyCount.load(std::memory_order_relaxed);
+            history[slot % HISTORY_FRAMES].store(static_cast<Uint64>(beatFrame.load(std::memory_order_relaxed)) << 32 |
+                (micros < 0xFFFFFFFF ? micros : 0xFFFFFFFF), std::memory_order_relaxed);
+            historyCount.store(slot + 1, std::memory_order_relaxed);
+        }
+        beatFrame.store(frameIndex, std::memory_order_relaxed);
+        lastBeat.store(now, std::memory_order_release);
+    }
+
+    Stats stats() const;
+
+private:
+    struct Sample {
+        double atMs;                // since the frame started
+        const char* zone;
+        int frameCount;
+        void* frames[MAX_STACK_FRAMES];
+    };
+
+    void watchLoop();
+    void takeSample(Sample& sample, double atMs);
+    int captureStack(void** frames, int maxFrames);
+    int copyTimeline(Uint32 lastFrame, Uint64* timeline) const;
+    void writeReport(Uint32 frame, double durationMs, const Sample* samples, int sampleCount,
+        const Uint64* timeline, int timelineCount);
+
+    Uint64 frequency;
+    double thresholdMs;
+    std::string reportPath;
+    std::thread watchdogThread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+
+    // Written by the watched thread
+    std::atomic<Uint64> lastBeat;
+    std::atomic<Uint32> beatFrame;
+    std::atomic<Uint64> history[HISTORY_FRAMES];   // frame index << 32 | duration in microseconds
+    std::atomic<Uint32> historyCount;
+
+    std::atomic<Uint64> stalls;
+    std::atomic<double> worstMs;
+
+#ifdef _WIN32
+    void* watchedThread;        // HANDLE
+    bool symbolsLoaded;
+#else
+    pthread_t watchedThread;
+    struct sigaction previousAction;
+#endif
+};
+
+#endif // STALL_WATCHDOG_H
@@ -0,0 +1,264 @@
+#include "task_scheduler.h"
+#include <algorithm>
+#include <memory>
+#include <new>
+
+namespace {
+    const size_t CLASS_SIZES[] = { 64, 128, 256, 512, 1024, 2048 };
+    const int CLASS_COUNT = sizeof(CLASS_SIZES) / sizeof(CLASS_SIZES[0]);
+    const size_t CHUNK_BYTES = 64 * 1024;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct FramePoolState {
+        FreeBlock* freeLists[CLASS_COUNT] = {};
+        std::vector<std::unique_ptr<char[]>> chunks;
+        char* chunkCursor = nullptr;
+        size_t chunkRemaining = 0;
+        size_t reserved = 0;
+        size_t live = 0;
+    };
+
+    FramePoolState& framePool() {
+        static FramePoolState state;
+        return state;
+    }
+
+    int sizeClass(size_t size) {
+        for (int i = 0; i < CLASS_COUNT; i++) {
+            if (size <= CLASS_SIZES[i]) return i;
+        }
+        return -1;
+    }
+}
+
+void* TaskFramePool::allocate(size_t size) {
+    FramePoolState& pool = framePool();
+    pool.live++;
+
+    int index = sizeClass(size);
+    if (index < 0) return ::operator new(size);
+
+    if (FreeBlock* block = pool.freeLists[index]) {
+        pool.freeLists[index] = block->next;
+        return block;
+    }
+
+    size_t blockSize = CLASS_SIZES[index];
+    if (pool.chunkRemaining < blockSize) {
+        pool.chunks.emplace_back(new char[CHUNK_BYTES]);
+        pool.chunkCursor = pool.chunks.back().get();
+        pool.chunkRemaining = CHUNK_BYTES;
+        pool.reserved += CHUNK_BYTES;
+    }
+    void* block = pool.chunkCursor;
+    pool.chunkCursor += blockSize;
+    pool.chunkRemaining -= blockSize;
+    return block;
+}
+
+void TaskFramePool::release(void* pointer, size_t size) {
+    FramePoolState& pool = framePool();
+    pool.live--;
+
+    int index = sizeClass(size);
+    if (index < 0) {
+        ::operator delete(pointer);
+        return;
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(pointer);
+    block->next = pool.freeLists[index];
+    pool.freeLists[index] = block;
+}
+
+size_t TaskFramePool::reservedBytes() {
+    return framePool().reserved;
+}
+
+size_t TaskFramePool::liveFrames() {
+    return framePool().live;
+}
+
+Task& Task::operator=(Task&& other) noexcept {
+    if (this != &other) {
+        if (handle) handle.destroy();
+        handle = other.handle;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+Task::~Task() {
+    if (handle) handle.destroy();
+}
+
+TaskEvent::~TaskEvent() {
+    // Tasks still waiting will never be woken; the scheduler frees them when
+    // they are cancelled or it shuts down.
+    for (TaskHandle waiter : waiters) waiter.promise().waitList = nullptr;
+}
+
+void TaskEvent::signal() {
+    // A woken task signalling the same event again has nobody new to wake.
+    if (signalling || waiters.empty()) return;
+    signalling = true;
+    TaskScheduler::wakeAll(waiters, waking);
+    signalling = false;
+}
+
+TaskScheduler::TaskScheduler(TimerWheel& timerWheel)
+    : timers(timerWheel),
+    freeSlot(NO_SLOT),
+    liveCount(0),
+    peakCount(0),
+    resumeCount(0) {
+}
+
+TaskScheduler::~TaskScheduler() {
+    cancelAll();
+}
+
+TaskId TaskScheduler::start(Task task) {
+    TaskHandle handle = task.handle;
+    if (!handle) return TaskId();
+    task.handle = nullptr;
+
+    Uint32 index;
+    if (freeSlot != NO_SLOT) {
+        index = freeSlot;
+        freeSlot = slots[index].nextFree;
+    }
+    else {
+        index = static_cast<Uint32>(slots.size());
+        slots.push_back({ nullptr, 1, NO_SLOT });
+    }
+    slots[index].handle = handle;
+
+    Task::promise_type& promise = handle.promise();
+    promise.scheduler = this;
+    promise.slot = index;
+    liveCount++;
+    peakCount = std::max(peakCount, liveCount);
+
+    TaskId id;
+    id.index = index;
+    id.generation = slots[index].generation;
+    resume(handle);
+    return isRunning(id) ? id : TaskId();
+}
+
+bool TaskScheduler::cancel(TaskId& id) {
+    bool running = isRunning(id);
+    if (running) {
+        TaskHandle handle = slots[id.index].handle;
+        // A task cancelled from inside itself is destroyed once it suspends.
+        if (handle.promise().running) handle.promise().cancelRequested = true;
+        else destroy(handle);
+    }
+    id = TaskId();
+    return running;
+}
+
+bool TaskScheduler::isRunning(TaskId id) const {
+    return id.generation != 0 && id.index < slots.size() &&
+        slots[id.index].generation == id.generation && slots[id.index].handle;
+}
+
+void TaskScheduler::cancelAll() {
+    for (auto& slot : slots) {
+        if (!slot.handle) continue;
+        if (slot.handle.promise().running) slot.handle.promise().cancelRequested = true;
+        else destroy(slot.handle);
+    }
+}
+
+void TaskScheduler::runFrame() {
+    wakeAll(frameWaiters, frameRunning);
+}
+
+TaskScheduler::Stats TaskScheduler::stats() const {
+    return { liveCount, peakCount, resumeCount, TaskFramePool::reservedBytes() };
+}
+
+void TaskScheduler::waitOn(TaskHandle handle, std::vector<TaskHandle>& list) {
+    Task::promise_type& promise = handle.promise();
+    promise.waitList = &list;
+    promise.waitIndex = list.size();
+    promise.waking = false;
+    list.push_back(handle);
+}
+
+void TaskScheduler::waitTimer(TaskHandle handle, Uint32 ms) {
+    TaskScheduler* scheduler = this;
+    handle.promise().timer = timers.schedule(ms, [scheduler, handle] {
+        handle.promise().timer = TimerId();
+        scheduler->resume(handle);
+    });
+}
+
+void TaskScheduler::wakeAll(std::vector<TaskHandle>& list, std::vector<TaskHandle>& running) {
+    // Tasks that wait on the same list again while being woken land in the
+    // emptied list and wait for the next round.
+    running.swap(list);
+    for (size_t i = 0; i < running.size(); i++) {
+        Task::promise_type& promise = running[i].promise();
+        promise.waitList = &running;
+        promise.waitIndex = i;
+        promise.waking = true;
+    }
+
+    for (size_t i = 0; i < running.size(); i++) {
+        TaskHandle handle = running[i];
+        if (!handle) continue;   // cancelled by a task woken before it
+        running[i] = nullptr;
+        Task::promise_type& promise = handle.promise();
+        promise.waitList = nullptr;
+        promise.waking = false;
+        promise.scheduler->resume(handle);
+    }
+    running.clear();
+}
+
+void TaskScheduler::resume(TaskHandle handle) {
+    Task::promise_type& promise = handle.promise();
+    promise.running = true;
+    handle.resume();
+    promise.running = false;
+    resumeCount++;
+
+    if (handle.done() || promise.cancelRequested) destroy(handle);
+}
+
+void TaskScheduler::destroy(TaskHandle handle) {
+    unhook(handle);
+
+    Uint32 index = handle.promise().slot;
+    Slot& slot = slots[index];
+    slot.handle = nullptr;
+    if (++slot.generation == 0) slot.generation = 1;
+    slot.nextFree = freeSlot;
+    freeSlot = index;
+    liveCount--;
+
+    handle.destroy();
+}
+
+void TaskScheduler::unhook(TaskHandle handle) {
+    Task::promise_type& promise = handle.promise();
+    timers.cancel(promise.timer);
+
+    if (std::vector<TaskHandle>* list = promise.waitList) {
+        if (promise.waking) {
+            (*list)[promise.waitIndex] = nullptr;
+        }
+        else {
+            TaskHandle last = list->back();
+            (*list)[promise.waitIndex] = last;
+            last.promise().waitIndex = promise.waitIndex;
+            list->pop_back();
+        }
+        promise.waitList = nullptr;
+    }
+}
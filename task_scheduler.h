@@ -0,0 +1,184 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <SDL.h>
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include "timer_wheel.h"
+
+class TaskScheduler;
+
+// Size-class free lists for coroutine frames, carved from chunks that are kept
+// for reuse, so starting a task after warm-up does not touch the heap. Frames
+// larger than the biggest class go to the global heap. Main thread only.
+class TaskFramePool {
+public:
+    static void* allocate(size_t size);
+    static void release(void* pointer, size_t size);
+
+    static size_t reservedBytes();
+    static size_t liveFrames();
+};
+
+// Coroutine returned by game sequences. It does nothing until handed to
+// TaskScheduler::start(), which then owns it.
+class Task {
+public:
+    struct promise_type {
+        TaskScheduler* scheduler = nullptr;
+        Uint32 slot = 0;
+        bool running = false;
+        bool cancelRequested = false;
+
+        // What the suspended task is waiting on, so it can be unhooked when
+        // cancelled.
+        TimerId timer;
+        std::vector<std::coroutine_handle<promise_type>>* waitList = nullptr;
+        size_t waitIndex = 0;
+        bool waking = false;
+
+        static void* operator new(size_t size) { return TaskFramePool::allocate(size); }
+        static void operator delete(void* pointer, size_t size) { TaskFramePool::release(pointer, size); }
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() : handle(nullptr) {}
+    Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Task& operator=(Task&& other) noexcept;
+    ~Task();
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+private:
+    friend class TaskScheduler;
+    explicit Task(Handle coroutine) : handle(coroutine) {}
+
+    Handle handle;
+};
+
+using TaskHandle = Task::Handle;
+
+struct TaskId {
+    Uint32 index = 0;
+    Uint32 generation = 0;
+
+    explicit operator bool() const { return generation != 0; }
+};
+
+// Wakes every task waiting on it when signalled. Signals are not remembered:
+// a task that starts waiting afterwards waits for the next one.
+class TaskEvent {
+public:
+    TaskEvent() : signalling(false) {}
+    ~TaskEvent();
+
+    TaskEvent(const TaskEvent&) = delete;
+    TaskEvent& operator=(const TaskEvent&) = delete;
+
+    void signal();
+    size_t waiting() const { return waiters.size(); }
+
+private:
+    friend class TaskScheduler;
+
+    std::vector<TaskHandle> waiters;
+    std::vector<TaskHandle> waking;
+    bool signalling;
+};
+
+// Runs Tasks on the main thread. A suspended task sits in exactly one place -
+// the next-frame queue, a timer on the wheel or an event's waiter list - and
+// costs nothing until that wakes it.
+class TaskScheduler {
+public:
+    struct Stats {
+        size_t liveTasks;
+        size_t peakTasks;
+        Uint64 resumes;
+        size_t frameBytes;
+    };
+
+    struct NextFrame {
+        TaskScheduler* scheduler;
+        bool await_ready() const { return false; }
+        void await_suspend(TaskHandle handle) { scheduler->waitOn(handle, scheduler->frameWaiters); }
+        void await_resume() {}
+    };
+
+    struct Delay {
+        TaskScheduler* scheduler;
+        Uint32 ms;
+        bool await_ready() const { return false; }
+        void await_suspend(TaskHandle handle) { scheduler->waitTimer(handle, ms); }
+        void await_resume() {}
+    };
+
+    struct EventWait {
+        TaskScheduler* scheduler;
+        TaskEvent* event;
+        bool await_ready() const { return false; }
+        void await_suspend(TaskHandle handle) { scheduler->waitOn(handle, event->waiters); }
+        void await_resume() {}
+    };
+
+    explicit TaskScheduler(TimerWheel& timerWheel);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Runs the task up to its first suspension. Returns an empty id if it
+    // finished straight away.
+    TaskId start(Task task);
+    bool cancel(TaskId& id);
+    bool isRunning(TaskId id) const;
+    void cancelAll();
+
+    // Resumes the tasks that awaited nextFrame() during the previous frame.
+    void runFrame();
+
+    NextFrame nextFrame() { return { this }; }
+    Delay milliseconds(Uint32 ms) { return { this, ms }; }
+    Delay seconds(float seconds) { return { this, static_cast<Uint32>(seconds * 1000.0f + 0.5f) }; }
+    EventWait wait(TaskEvent& event) { return { this, &event }; }
+
+    Stats stats() const;
+
+private:
+    friend class TaskEvent;
+
+    struct Slot {
+        TaskHandle handle;
+        Uint32 generation;
+        Uint32 nextFree;
+    };
+
+    static const Uint32 NO_SLOT = 0xFFFFFFFF;
+
+    void waitOn(TaskHandle handle, std::vector<TaskHandle>& list);
+    void waitTimer(TaskHandle handle, Uint32 ms);
+    static void wakeAll(std::vector<TaskHandle>& list, std::vector<TaskHandle>& running);
+    void resume(TaskHandle handle);
+    void destroy(TaskHandle handle);
+    void unhook(TaskHandle handle);
+
+    TimerWheel& timers;
+    std::vector<Slot> slots;
+    Uint32 freeSlot;
+    size_t liveCount;
+    size_t peakCount;
+    Uint64 resumeCount;
+    std::vector<TaskHandle> frameWaiters;
+    std::vector<TaskHandle> frameRunning;
+};
+
+#endif // TASK_SCHEDULER_H
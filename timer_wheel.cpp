@@ -0,0 +1,214 @@
+#include "timer_wheel.h"
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    int lowestSetBit(Uint64 value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+}
+
+TimerWheel::TimerWheel()
+    : freeList(NONE),
+    currentTick(0),
+    pending(0) {
+    for (auto& slot : slots) slot.head = NONE;
+    std::memset(occupied, 0, sizeof(occupied));
+}
+
+void TimerWheel::reset(Uint64 now) {
+    // Pending timers keep their remaining time relative to the new tick.
+    std::vector<Sint32> live;
+    for (int i = 0; i < LEVELS * SLOTS; i++) {
+        while (slots[i].head != NONE) {
+            Sint32 index = slots[i].head;
+            unlink(index);
+            nodes[index].expiry -= currentTick;
+            live.push_back(index);
+        }
+    }
+    currentTick = now;
+    for (Sint32 index : live) {
+        nodes[index].expiry += currentTick;
+        insert(index);
+    }
+}
+
+void TimerWheel::advance(Uint64 now) {
+    const Uint64 slotMask = SLOTS - 1;
+    while (currentTick < now) {
+        // The next tick worth visiting is either an occupied level-0 slot in
+        // this lap, or the start of the next lap where higher levels cascade.
+        Uint64 lapStart = currentTick & ~slotMask;
+        Uint64 nextLap = lapStart + SLOTS;
+        Uint64 next = nextLap;
+        if (currentTick + 1 < nextLap) {
+            int index = nextOccupied(0, static_cast<int>((currentTick + 1) & slotMask));
+            if (index >= 0) next = lapStart + index;
+        }
+
+        if (next > now) {
+            currentTick = now;
+            break;
+        }
+        currentTick = next;
+
+        if ((currentTick & slotMask) == 0) {
+            for (int level = LEVELS - 1; level > 0; level--) {
+                Uint64 lowerBits = (Uint64(1) << (level * SLOT_BITS)) - 1;
+                if ((currentTick & lowerBits) == 0) cascade(level);
+            }
+        }
+        fireSlot(static_cast<int>(currentTick & slotMask));
+    }
+}
+
+TimerId TimerWheel::schedule(Uint64 delay, TimerCallback callback, Uint64 period) {
+    Sint32 index;
+    if (freeList != NONE) {
+        index = freeList;
+        freeList = nodes[index].next;
+    }
+    else {
+        index = static_cast<Sint32>(nodes.size());
+        nodes.push_back(Node());
+        nodes[index].generation = 1;
+    }
+
+    Node& node = nodes[index];
+    node.expiry = currentTick + std::max<Uint64>(1, delay);
+    node.period = period;
+    node.callback = callback;
+    node.state = NODE_PENDING;
+    insert(index);
+    pending++;
+
+    TimerId id;
+    id.index = static_cast<Uint32>(index);
+    id.generation = node.generation;
+    return id;
+}
+
+bool TimerWheel::cancel(TimerId& id) {
+    bool valid = validNode(id);
+    if (valid) {
+        Sint32 index = static_cast<Sint32>(id.index);
+        // A timer cancelled from inside its own callback is already unlinked.
+        if (nodes[index].state == NODE_PENDING) unlink(index);
+        release(index);
+    }
+    id = TimerId();
+    return valid;
+}
+
+bool TimerWheel::isPending(TimerId id) const {
+    return validNode(id);
+}
+
+Uint64 TimerWheel::remaining(TimerId id) const {
+    if (!validNode(id) || nodes[id.index].state != NODE_PENDING) return 0;
+    return nodes[id.index].expiry - currentTick;
+}
+
+void TimerWheel::insert(Sint32 index) {
+    Node& node = nodes[index];
+    Uint64 delta = node.expiry > currentTick ? node.expiry - currentTick : 0;
+
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (Uint64(1) << ((level + 1) * SLOT_BITS))) level++;
+
+    int slotIndex;
+    if (delta >> (LEVELS * SLOT_BITS)) {
+        // Beyond the wheel's range: park in the last slot of the top level's
+        // lap and re-place when it cascades.
+        slotIndex = static_cast<int>(((currentTick >> (level * SLOT_BITS)) + SLOTS - 1) & (SLOTS - 1));
+    }
+    else {
+        slotIndex = static_cast<int>((node.expiry >> (level * SLOT_BITS)) & (SLOTS - 1));
+    }
+
+    int slot = level * SLOTS + slotIndex;
+    node.slot = static_cast<Uint16>(slot);
+    node.prev = NONE;
+    node.next = slots[slot].head;
+    if (node.next != NONE) nodes[node.next].prev = index;
+    slots[slot].head = index;
+    occupied[level][slotIndex >> 6] |= Uint64(1) << (slotIndex & 63);
+}
+
+void TimerWheel::unlink(Sint32 index) {
+    Node& node = nodes[index];
+    if (node.prev != NONE) nodes[node.prev].next = node.next;
+    else slots[node.slot].head = node.next;
+    if (node.next != NONE) nodes[node.next].prev = node.prev;
+
+    if (slots[node.slot].head == NONE) {
+        int level = node.slot / SLOTS;
+        int slotIndex = node.slot % SLOTS;
+        occupied[level][slotIndex >> 6] &= ~(Uint64(1) << (slotIndex & 63));
+    }
+}
+
+void TimerWheel::release(Sint32 index) {
+    Node& node = nodes[index];
+    node.state = NODE_FREE;
+    if (++node.generation == 0) node.generation = 1;
+    node.next = freeList;
+    freeList = index;
+    pending--;
+}
+
+void TimerWheel::cascade(int level) {
+    int slot = level * SLOTS + static_cast<int>((currentTick >> (level * SLOT_BITS)) & (SLOTS - 1));
+    while (slots[slot].head != NONE) {
+        Sint32 index = slots[slot].head;
+        unlink(index);
+        insert(index);
+    }
+}
+
+void TimerWheel::fireSlot(int slotIndex) {
+    while (slots[slotIndex].head != NONE) {
+        Sint32 index = slots[slotIndex].head;
+        unlink(index);
+        nodes[index].state = NODE_FIRING;
+
+        // The callback may schedule timers and grow the node pool, so run a
+        // copy and look the node up again afterwards.
+        TimerCallback callback = nodes[index].callback;
+        callback();
+
+        Node& node = nodes[index];
+        if (node.state != NODE_FIRING) continue;   // cancelled by the callback
+        if (node.period > 0) {
+            node.expiry = currentTick + node.period;
+            node.state = NODE_PENDING;
+            insert(index);
+        }
+        else {
+            release(index);
+        }
+    }
+}
+
+int TimerWheel::nextOccupied(int level, int fromIndex) const {
+    for (int word = fromIndex >> 6; word < SLOTS / 64; word++) {
+        Uint64 bits = occupied[level][word];
+        if (word == fromIndex >> 6) bits &= ~Uint64(0) << (fromIndex & 63);
+        if (bits) return word * 64 + lowestSetBit(bits);
+    }
+    return -1;
+}
+
+bool TimerWheel::validNode(TimerId id) const {
+    return id.generation != 0 && id.index < nodes.size() &&
+        nodes[id.index].generation == id.generation && nodes[id.index].state != NODE_FREE;
+}
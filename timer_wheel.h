@@ -0,0 +1,102 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <SDL.h>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Handle to a scheduled timer. A default-constructed id refers to nothing, and
+// ids of timers that fired or were cancelled go stale instead of being reused.
+struct TimerId {
+    Uint32 index = 0;
+    Uint32 generation = 0;
+
+    explicit operator bool() const { return generation != 0; }
+};
+
+// Small callable stored inline in the timer node, so scheduling never
+// allocates. Lambdas capturing a pointer or two fit.
+class TimerCallback {
+public:
+    TimerCallback() : invoker(nullptr) {}
+
+    template <typename F>
+    TimerCallback(F function) {
+        static_assert(sizeof(F) <= sizeof(storage), "timer callback captures too much");
+        static_assert(std::is_trivially_copyable<F>::value, "timer callbacks must be trivially copyable");
+        new (storage) F(function);
+        invoker = [](void* callable) { (*static_cast<F*>(callable))(); };
+    }
+
+    void operator()() { if (invoker) invoker(storage); }
+
+private:
+    alignas(void*) unsigned char storage[3 * sizeof(void*)];
+    void (*invoker)(void*);
+};
+
+// Hierarchical timing wheel (four levels of 256 slots, one tick per
+// millisecond). Schedule and cancel are O(1); advance() only visits slots that
+// hold timers, so pending timers cost nothing until they come due.
+class TimerWheel {
+public:
+    TimerWheel();
+
+    // Moves the wheel to a new tick without firing anything; pending timers
+    // keep their remaining time.
+    void reset(Uint64 now);
+
+    // Runs every timer due at or before now, earliest tick first.
+    void advance(Uint64 now);
+
+    // Fires delay ticks from now (at least one). A non-zero period re-arms the
+    // timer after each call until it is cancelled.
+    TimerId schedule(Uint64 delay, TimerCallback callback, Uint64 period = 0);
+    bool cancel(TimerId& id);
+    bool isPending(TimerId id) const;
+    Uint64 remaining(TimerId id) const;
+
+    Uint64 now() const { return currentTick; }
+    size_t pendingCount() const { return pending; }
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const Sint32 NONE = -1;
+
+    enum NodeState { NODE_FREE, NODE_PENDING, NODE_FIRING };
+
+    struct Node {
+        Uint64 expiry;
+        Uint64 period;
+        TimerCallback callback;
+        Sint32 prev, next;
+        Uint32 generation;
+        Uint16 slot;      // level * SLOTS + index
+        Uint8 state;
+    };
+
+    struct Slot {
+        Sint32 head;
+    };
+
+    void insert(Sint32 index);
+    void unlink(Sint32 index);
+    void release(Sint32 index);
+    void cascade(int level);
+    void fireSlot(int slotIndex);
+    int nextOccupied(int level, int fromIndex) const;
+    bool validNode(TimerId id) const;
+
+    std::vector<Node> nodes;
+    Sint32 freeList;
+    Slot slots[LEVELS * SLOTS];
+    Uint64 occupied[LEVELS][SLOTS / 64];
+    Uint64 currentTick;
+    size_t pending;
+};
+
+#endif // TIMER_WHEEL_H
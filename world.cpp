@@ -0,0 +1,275 @@
+#include "world.h"
+#include "log.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    const int LOAD_MARGIN = 1;   // chunks streamed in around the view
+    const int KEEP_MARGIN = 2;   // chunks beyond this are evicted
+    const char CHUNK_MAGIC[4] = { 'S', 'N', 'K', 'C' };
+
+    uint64_t mixBits(uint64_t value) {
+        value += 0x9E3779B97F4A7C15ull;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    // Names chunkPath() produces: "<x>_<y>.chunk".
+    bool isChunkFileName(const std::string& name) {
+        const std::string suffix = ".chunk";
+        if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) return false;
+        std::string stem = name.substr(0, name.size() - suffix.size());
+        size_t separator = stem.find('_');
+        if (separator == 0 || separator == std::string::npos || separator + 1 == stem.size()) return false;
+        for (size_t i = 0; i < stem.size(); i++) {
+            if (i != separator && !std::isdigit(static_cast<unsigned char>(stem[i]))) return false;
+        }
+        return true;
+    }
+}
+
+World::World()
+    : opened(false),
+    widthCells(0),
+    heightCells(0),
+    chunksX(0),
+    chunksY(0),
+    seed(0),
+    stopping(false) {
+}
+
+World::~World() {
+    close();
+}
+
+void World::open(int worldWidthCells, int worldHeightCells, Uint32 worldSeed, const std::string& chunkDirectory) {
+    close();
+
+    widthCells = std::max(CHUNK_CELLS, worldWidthCells);
+    heightCells = std::max(CHUNK_CELLS, worldHeightCells);
+    chunksX = (widthCells + CHUNK_CELLS - 1) / CHUNK_CELLS;
+    chunksY = (heightCells + CHUNK_CELLS - 1) / CHUNK_CELLS;
+    seed = worldSeed;
+    directory = chunkDirectory;
+
+    // Chunk files only hold edits from the current session. Only files this
+    // class writes are removed; anything else in the directory is left alone.
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        LOG_WARN("World: cannot create {} ({}); edited chunks will not be kept", directory, error.message());
+    }
+    else {
+        for (std::filesystem::directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error)) {
+            std::error_code fileError;
+            if (entry->is_regular_file(fileError) && isChunkFileName(entry->path().filename().string())) {
+                std::filesystem::remove(entry->path(), fileError);
+            }
+        }
+        if (error) LOG_WARN("World: cannot clear old chunks in {} ({})", directory, error.message());
+    }
+
+    resident.reserve(64);
+    adopted.reserve(64);
+    finished.reserve(64);
+    evictions.reserve(64);
+
+    stopping = false;
+    opened = true;
+    worker = std::thread(&World::workerLoop, this);
+}
+
+void World::close() {
+    if (!opened) return;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const Job& job) { return job.type == Job::LOAD; }), jobs.end());
+        stopping = true;
+    }
+    jobReady.notify_one();
+    worker.join();
+
+    for (auto& slot : resident) delete slot.second;
+    for (WorldChunk* chunk : finished) delete chunk;
+    resident.clear();
+    finished.clear();
+    opened = false;
+}
+
+void World::updateStreaming(const SDL_Rect& view) {
+    if (!opened) return;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        adopted.swap(finished);
+    }
+    for (WorldChunk* chunk : adopted) {
+        auto slot = resident.find(chunkKey(chunk->chunkX, chunk->chunkY));
+        if (slot != resident.end() && !slot->second) {
+            slot->second = chunk;
+        }
+        else {
+            // Evicted (or requested twice) while the load was in flight.
+            delete chunk;
+        }
+    }
+    adopted.clear();
+
+    int firstX = std::max(0, view.x / CHUNK_PIXELS - LOAD_MARGIN);
+    int firstY = std::max(0, view.y / CHUNK_PIXELS - LOAD_MARGIN);
+    int lastX = std::min(chunksX - 1, (view.x + view.w) / CHUNK_PIXELS + LOAD_MARGIN);
+    int lastY = std::min(chunksY - 1, (view.y + view.h) / CHUNK_PIXELS + LOAD_MARGIN);
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        for (int chunkY = firstY; chunkY <= lastY; chunkY++) {
+            for (int chunkX = firstX; chunkX <= lastX; chunkX++) {
+                if (resident.emplace(chunkKey(chunkX, chunkY), nullptr).second) {
+                    jobs.push_back({ Job::LOAD, chunkX, chunkY, nullptr });
+                    queued = true;
+                }
+            }
+        }
+    }
+
+    int keepFirstX = firstX - (KEEP_MARGIN - LOAD_MARGIN);
+    int keepFirstY = firstY - (KEEP_MARGIN - LOAD_MARGIN);
+    int keepLastX = lastX + (KEEP_MARGIN - LOAD_MARGIN);
+    int keepLastY = lastY + (KEEP_MARGIN - LOAD_MARGIN);
+    for (const auto& slot : resident) {
+        int chunkX = static_cast<int>(slot.first >> 32);
+        int chunkY = static_cast<int>(static_cast<int32_t>(slot.first & 0xFFFFFFFF));
+        if (chunkX < keepFirstX || chunkX > keepLastX || chunkY < keepFirstY || chunkY > keepLastY) {
+            evictions.push_back(slot.first);
+        }
+    }
+    for (int64_t key : evictions) {
+        auto slot = resident.find(key);
+        if (slot->second) {
+            evict(slot->second);
+            queued = true;
+        }
+        resident.erase(slot);
+    }
+    evictions.clear();
+
+    if (queued) jobReady.notify_one();
+}
+
+bool World::consumeFoodNear(int x, int y, int radius) {
+    int firstX = std::max(0, (x - radius) / CHUNK_PIXELS);
+    int firstY = std::max(0, (y - radius) / CHUNK_PIXELS);
+    int lastX = std::min(chunksX - 1, (x + radius) / CHUNK_PIXELS);
+    int lastY = std::min(chunksY - 1, (y + radius) / CHUNK_PIXELS);
+
+    for (int chunkY = firstY; chunkY <= lastY; chunkY++) {
+        for (int chunkX = firstX; chunkX <= lastX; chunkX++) {
+            auto slot = resident.find(chunkKey(chunkX, chunkY));
+            if (slot == resident.end() || !slot->second) continue;
+
+            WorldChunk& chunk = *slot->second;
+            for (size_t i = 0; i < chunk.food.size(); i++) {
+                int foodX = chunkX * CHUNK_PIXELS + chunk.food[i].x * CELL_SIZE;
+                int foodY = chunkY * CHUNK_PIXELS + chunk.food[i].y * CELL_SIZE;
+                if (abs(x - foodX) < radius && abs(y - foodY) < radius) {
+                    chunk.food[i] = chunk.food.back();
+                    chunk.food.pop_back();
+                    chunk.dirty = true;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void World::evict(WorldChunk* chunk) {
+    if (chunk->dirty) {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.push_back({ Job::SAVE, chunk->chunkX, chunk->chunkY, chunk });
+    }
+    else {
+        delete chunk;
+    }
+}
+
+void World::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return;
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        if (job.type == Job::LOAD) {
+            WorldChunk* chunk = loadChunk(job.chunkX, job.chunkY);
+            std::lock_guard<std::mutex> lock(jobMutex);
+            finished.push_back(chunk);
+        }
+        else {
+            saveChunk(*job.chunk);
+            delete job.chunk;
+        }
+    }
+}
+
+WorldChunk* World::loadChunk(int chunkX, int chunkY) {
+    WorldChunk* chunk = new WorldChunk{ chunkX, chunkY, {}, false };
+
+    std::ifstream file(chunkPath(chunkX, chunkY), std::ios::binary);
+    if (file.is_open()) {
+        char magic[4];
+        unsigned char count[2];
+        if (file.read(magic, 4) && std::equal(magic, magic + 4, CHUNK_MAGIC) && file.read(reinterpret_cast<char*>(count), 2)) {
+            chunk->food.resize(count[0] | (count[1] << 8));
+            if (file.read(reinterpret_cast<char*>(chunk->food.data()), chunk->food.size() * sizeof(ChunkFood))) {
+                return chunk;
+            }
+        }
+        chunk->food.clear();
+    }
+
+    generateChunk(*chunk);
+    return chunk;
+}
+
+void World::generateChunk(WorldChunk& chunk) const {
+    uint64_t state = mixBits((static_cast<uint64_t>(seed) << 32) ^ static_cast<uint64_t>(chunkKey(chunk.chunkX, chunk.chunkY)));
+    int count = 3 + static_cast<int>(state % 6);
+
+    // Keep food inside the world when the last chunk is only partly covered.
+    int usableX = std::min(CHUNK_CELLS, widthCells - chunk.chunkX * CHUNK_CELLS) - 4;
+    int usableY = std::min(CHUNK_CELLS, heightCells - chunk.chunkY * CHUNK_CELLS) - 4;
+    if (usableX <= 2 || usableY <= 2) return;
+
+    chunk.food.reserve(count);
+    for (int i = 0; i < count; i++) {
+        state = mixBits(state);
+        int x = 2 + static_cast<int>(state % (usableX - 2));
+        int y = 2 + static_cast<int>((state >> 32) % (usableY - 2));
+        chunk.food.push_back({ static_cast<Uint8>(x), static_cast<Uint8>(y) });
+    }
+}
+
+void World::saveChunk(const WorldChunk& chunk) const {
+    std::ofstream file(chunkPath(chunk.chunkX, chunk.chunkY), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return;
+
+    unsigned char count[2] = { static_cast<unsigned char>(chunk.food.size() & 0xFF), static_cast<unsigned char>(chunk.food.size() >> 8) };
+    file.write(CHUNK_MAGIC, 4);
+    file.write(reinterpret_cast<const char*>(count), 2);
+    file.write(reinterpret_cast<const char*>(chunk.food.data()), chunk.food.size() * sizeof(ChunkFood));
+}
+
+std::string World::chunkPath(int chunkX, int chunkY) const {
+    return directory + "/" + std::to_string(chunkX) + "_" + std::to_string(chunkY) + ".chunk";
+}
@@ -0,0 +1,112 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <SDL.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Food inside a chunk, in chunk-local cell coordinates.
+struct ChunkFood {
+    Uint8 x, y;
+};
+
+struct WorldChunk {
+    int chunkX, chunkY;
+    std::vector<ChunkFood> food;
+    bool dirty;
+};
+
+// Scrolling snake world split into fixed-size chunks. Only chunks around the
+// camera are resident; the rest live on disk (if they were modified) or are
+// regenerated from the world seed. Loading and saving happen on a background
+// thread so the frame never waits on the file system.
+class World {
+public:
+    static constexpr int CELL_SIZE = 4;       // pixels per cell, one snake step
+    static constexpr int CHUNK_CELLS = 256;   // cells per chunk side
+    static constexpr int CHUNK_PIXELS = CELL_SIZE * CHUNK_CELLS;
+
+    World();
+    ~World();
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    void open(int widthCells, int heightCells, Uint32 seed, const std::string& chunkDirectory = "world_chunks");
+    void close();
+    bool isOpen() const { return opened; }
+
+    // Requests chunks around the view, evicts distant ones and adopts chunks the
+    // loader has finished. Call once per frame with the camera in world pixels.
+    void updateStreaming(const SDL_Rect& view);
+
+    // Removes a resident food item within radius pixels of (x, y).
+    bool consumeFoodNear(int x, int y, int radius);
+
+    int pixelWidth() const { return widthCells * CELL_SIZE; }
+    int pixelHeight() const { return heightCells * CELL_SIZE; }
+    size_t residentChunkCount() const { return resident.size(); }
+
+    template <typename Visitor>
+    void forEachFoodInView(const SDL_Rect& view, Visitor visit) const {
+        for (const auto& slot : resident) {
+            const WorldChunk* chunk = slot.second;
+            if (!chunk) continue;
+            int originX = chunk->chunkX * CHUNK_PIXELS;
+            int originY = chunk->chunkY * CHUNK_PIXELS;
+            if (originX >= view.x + view.w || originX + CHUNK_PIXELS <= view.x ||
+                originY >= view.y + view.h || originY + CHUNK_PIXELS <= view.y) {
+                continue;
+            }
+            for (const auto& food : chunk->food) {
+                int x = originX + food.x * CELL_SIZE;
+                int y = originY + food.y * CELL_SIZE;
+                if (x + 10 > view.x && x < view.x + view.w && y + 10 > view.y && y < view.y + view.h) {
+                    visit(x, y);
+                }
+            }
+        }
+    }
+
+private:
+    struct Job {
+        enum Type { LOAD, SAVE } type;
+        int chunkX, chunkY;
+        WorldChunk* chunk;
+    };
+
+    static int64_t chunkKey(int chunkX, int chunkY) { return (static_cast<int64_t>(chunkX) << 32) | static_cast<uint32_t>(chunkY); }
+
+    void workerLoop();
+    WorldChunk* loadChunk(int chunkX, int chunkY);
+    void generateChunk(WorldChunk& chunk) const;
+    void saveChunk(const WorldChunk& chunk) const;
+    std::string chunkPath(int chunkX, int chunkY) const;
+    void evict(WorldChunk* chunk);
+
+    bool opened;
+    int widthCells, heightCells;
+    int chunksX, chunksY;
+    Uint32 seed;
+    std::string directory;
+
+    // nullptr marks a chunk whose load is still in flight.
+    std::unordered_map<int64_t, WorldChunk*> resident;
+    std::vector<WorldChunk*> adopted;
+    std::vector<int64_t> evictions;
+
+    std::thread worker;
+    std::mutex jobMutex;
+    std::condition_variable jobReady;
+    std::deque<Job> jobs;
+    std::vector<WorldChunk*> finished;
+    bool stopping;
+};
+
+#endif // WORLD_H